@@ -0,0 +1,119 @@
+// Микробенчмарк чисел JSON: json::number против strtod и ostream << setprecision(6).
+// Сборка из корня репозитория:
+//   g++ -std=c++17 -O2 -Itransport-catalogue benchmarks/json_number_benchmark.cpp transport-catalogue/json.cpp
+//
+// Наборы данных:
+//   coordinates - разбор широт и долгот с 14-15 знаками и целых road_distances,
+//                 как в base_requests;
+//   route_times - печать total_time и time элементов ответов Route
+//                 (дробные минуты) и span_count
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json_number.h"
+
+namespace {
+
+    template <typename Function>
+    double MeasureSeconds(Function function) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Report(const char* name, size_t count, double baseline, double codec) {
+        std::printf("%-14s %9zu numbers   baseline %7.1f ns   codec %7.1f ns   x%.2f\n",
+                    name, count, baseline * 1e9 / count, codec * 1e9 / count, baseline / codec);
+    }
+
+    // Числа в том виде, в каком они записаны во входном документе
+    std::vector<std::string> MakeCoordinates(size_t count) {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> latitude(55.5, 56.0);
+        std::uniform_int_distribution<int> distance(100, 20000);
+        std::vector<std::string> numbers;
+        for (size_t i = 0; i < count; ++i) {
+            std::ostringstream out;
+            if (i % 3 == 2) {
+                out << distance(generator);
+            } else {
+                out << std::setprecision(15) << latitude(generator);
+            }
+            numbers.push_back(out.str());
+        }
+        return numbers;
+    }
+
+    void BenchmarkCoordinates(size_t count) {
+        const std::vector<std::string> numbers = MakeCoordinates(count);
+        double sum_baseline = 0;
+        double sum_codec = 0;
+        const double baseline = MeasureSeconds([&]{
+            for (const std::string& number : numbers) {
+                sum_baseline += std::strtod(number.c_str(), nullptr);
+            }
+        });
+        const double codec = MeasureSeconds([&]{
+            for (const std::string& number : numbers) {
+                const char* begin = number.data();
+                const char* end = begin + number.size();
+                if (const auto value = json::number::ParseInt(begin, end)) {
+                    sum_codec += *value;
+                } else {
+                    sum_codec += json::number::ParseDouble(begin, end);
+                }
+            }
+        });
+        if (sum_baseline != sum_codec) {
+            std::printf("coordinates: results differ\n");
+        }
+        Report("coordinates", numbers.size(), baseline, codec);
+    }
+
+    void BenchmarkRouteTimes(size_t count) {
+        std::mt19937 generator(7);
+        std::uniform_real_distribution<double> minutes(0.5, 300.0);
+        std::uniform_int_distribution<int> spans(1, 40);
+        std::vector<double> times(count);
+        std::vector<int> span_counts(count);
+        for (size_t i = 0; i < count; ++i) {
+            times[i] = minutes(generator);
+            span_counts[i] = spans(generator);
+        }
+
+        std::ostringstream stream_out;
+        const double baseline = MeasureSeconds([&]{
+            stream_out << std::setprecision(6);
+            for (size_t i = 0; i < count; ++i) {
+                stream_out << times[i] << ',' << span_counts[i] << ',';
+            }
+        });
+        std::string codec_out;
+        const double codec = MeasureSeconds([&]{
+            char buffer[json::number::MAX_LENGTH];
+            for (size_t i = 0; i < count; ++i) {
+                codec_out.append(buffer, json::number::Format(times[i], buffer, json::DoubleFormat::PRECISION));
+                codec_out.push_back(',');
+                codec_out.append(buffer, json::number::Format(span_counts[i], buffer));
+                codec_out.push_back(',');
+            }
+        });
+        if (stream_out.str() != codec_out) {
+            std::printf("route_times: outputs differ\n");
+        }
+        Report("route_times", count * 2, baseline, codec);
+    }
+
+}
+
+int main() {
+    BenchmarkCoordinates(3'000'000);
+    BenchmarkRouteTimes(2'000'000);
+}
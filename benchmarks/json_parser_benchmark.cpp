@@ -0,0 +1,124 @@
+// Скорость разбора JSON в МБ/с: исходный загрузчик из потока (legacy_json_loader.h)
+// против load::Parser из json.cpp - с построением json::Document, с построением
+// json::arena::Document и без дерева (пустой EventHandler).
+// Сборка из корня репозитория:
+//   g++ -std=c++17 -O2 -Itransport-catalogue -o json_parser_benchmark benchmarks/json_parser_benchmark.cpp transport-catalogue/json.cpp transport-catalogue/json_arena.cpp
+// Запуск: ./json_parser_benchmark [файл.json ...]
+// Без аргументов разбирается сгенерированный вход в духе make_base: остановки
+// с координатами и road_distances, маршруты и stat_requests, около 20 МБ
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json.h"
+#include "json_arena.h"
+#include "legacy_json_loader.h"
+
+namespace {
+
+    template <typename Function>
+    double MeasureSeconds(Function function) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Лучшее время из repeat_count запусков
+    template <typename Function>
+    double BestSeconds(size_t repeat_count, Function function) {
+        double best = MeasureSeconds(function);
+        for (size_t i = 1; i < repeat_count; ++i) {
+            best = std::min(best, MeasureSeconds(function));
+        }
+        return best;
+    }
+
+    std::string MakeDocument(size_t stop_count) {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> latitude(55.5, 56.0);
+        std::uniform_real_distribution<double> longitude(37.3, 37.9);
+        std::uniform_int_distribution<size_t> stop(0, stop_count - 1);
+        std::uniform_int_distribution<int> distance(100, 20000);
+
+        std::ostringstream out;
+        out.precision(15);
+        out << "{\n    \"base_requests\": [\n";
+        for (size_t i = 0; i < stop_count; ++i) {
+            out << "        {\"type\": \"Stop\", \"name\": \"Stop " << i << "\", \"latitude\": " << latitude(generator)
+                << ", \"longitude\": " << longitude(generator) << ", \"road_distances\": {";
+            for (int j = 0; j < 3; ++j) {
+                out << (j ? ", " : "") << "\"Stop " << stop(generator) << "\": " << distance(generator);
+            }
+            out << "}},\n";
+        }
+        for (size_t i = 0; i < stop_count / 20; ++i) {
+            out << "        {\"type\": \"Bus\", \"name\": \"Bus " << i << "\", \"is_roundtrip\": " << (i % 2 ? "true" : "false")
+                << ", \"stops\": [";
+            for (int j = 0; j < 20; ++j) {
+                out << (j ? ", " : "") << "\"Stop " << stop(generator) << '"';
+            }
+            out << "]},\n";
+        }
+        out << "        {\"type\": \"Stop\", \"name\": \"Last \\\"stop\\\"\", \"latitude\": 55.7, \"longitude\": 37.6, \"road_distances\": {}}\n"
+            << "    ],\n    \"stat_requests\": [\n";
+        for (size_t i = 0; i < stop_count * 2; ++i) {
+            out << "        {\"id\": " << i << ", \"type\": \"Route\", \"from\": \"Stop " << stop(generator)
+                << "\", \"to\": \"Stop " << stop(generator) << "\"},\n";
+        }
+        out << "        {\"id\": -1, \"type\": \"Map\"}\n    ]\n}\n";
+        return out.str();
+    }
+
+    void Benchmark(const std::string& name, const std::string& text) {
+        constexpr size_t REPEAT_COUNT = 3;
+        const double megabytes = text.size() / 1e6;
+        auto report = [megabytes](const char* parser, double seconds) {
+            std::printf("  %-26s %8.1f MB/s\n", parser, megabytes / seconds);
+        };
+        std::printf("%s: %.1f MB\n", name.c_str(), megabytes);
+
+        const double legacy = BestSeconds(REPEAT_COUNT, [&text]{
+            std::istringstream input(text);
+            legacy_json::Load(input);
+        });
+        report("legacy istream -> Document", legacy);
+
+        const double tree = BestSeconds(REPEAT_COUNT, [&text]{
+            json::Load(std::string_view(text));
+        });
+        report("Parser -> Document", tree);
+
+        const double arena = BestSeconds(REPEAT_COUNT, [&text]{
+            json::arena::Load(std::string_view(text));
+        });
+        report("Parser -> arena::Document", arena);
+
+        const double events = BestSeconds(REPEAT_COUNT, [&text]{
+            json::EventHandler handler;
+            json::Parse(std::string_view(text), handler);
+        });
+        report("Parser -> no tree", events);
+
+        std::istringstream input(text);
+        if (legacy_json::Load(input) != json::Load(std::string_view(text))) {
+            std::printf("  documents differ\n");
+        }
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        Benchmark("generated", MakeDocument(60'000));
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        Benchmark(argv[i], json::ReadAll(file));
+    }
+}
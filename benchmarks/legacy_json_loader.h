@@ -0,0 +1,216 @@
+#pragma once
+
+// Загрузчик JSON из первой версии проекта: посимвольное чтение из std::istream
+// через get/peek/putback. Оставлен только для сравнения в json_parser_benchmark.cpp
+// и строит то же дерево json::Node, что и json::Load, чтобы результаты можно было
+// сравнить. Отличия от исходного кода: функции inline, без печати в std::cerr
+
+#include <cctype>
+#include <istream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include "json.h"
+
+namespace legacy_json {
+
+    using json::ParsingError;
+
+    inline std::string ClearLine(const std::string& str) {
+        size_t start = 0, end = str.length();
+        while (start < str.length()
+               && (str[start] == '\n' || str[start] == '\r' || str[start] == '\t' || str[start] == ' ')) {
+            start++;
+        }
+        while (end > 0
+               && (str[end - 1] == '\n' || str[end - 1] == '\r' || str[end - 1] == '\t' || str[end - 1] == ' ')) {
+            end--;
+        }
+        return str.substr(start, end - start);
+    }
+
+    inline std::string FindEndOfLine(std::istream& input) {
+        std::string result;
+        char ch;
+        while (input.get(ch)) {
+            if (ch == '}' || ch == ',' || ch == ']') {
+                input.putback(ch);
+                break;
+            }
+            result += ch;
+        }
+        return result;
+    }
+
+    json::Node LoadNode(std::istream& input);
+
+    inline json::Node LoadNull(std::istream& input) {
+        if (ClearLine(FindEndOfLine(input)) != "null") {
+            throw ParsingError("Error while parsing JSON, wrong argument - null");
+        }
+        return json::Node();
+    }
+
+    inline json::Node LoadBool(std::istream& input) {
+        const std::string line = ClearLine(FindEndOfLine(input));
+        if (line != "true" && line != "false") {
+            throw ParsingError("Error while parsing JSON, wrong argument - bool");
+        }
+        return json::Node(line == "true");
+    }
+
+    inline json::Node LoadArray(std::istream& input) {
+        json::Array result;
+        if (input.peek() == -1) {
+            throw ParsingError("Unexpected end of input");
+        }
+        for (char c; input >> c && c != ']';) {
+            if (c != ',') {
+                input.putback(c);
+            }
+            result.push_back(LoadNode(input));
+        }
+        return json::Node(std::move(result));
+    }
+
+    inline json::Node LoadNumber(std::istream& input) {
+        std::string parsed_num;
+
+        auto read_char = [&parsed_num, &input] {
+            parsed_num += static_cast<char>(input.get());
+            if (!input) {
+                throw ParsingError("Failed to read number from stream");
+            }
+        };
+        auto read_digits = [&input, read_char] {
+            if (!std::isdigit(input.peek())) {
+                throw ParsingError("A digit is expected");
+            }
+            while (std::isdigit(input.peek())) {
+                read_char();
+            }
+        };
+
+        if (input.peek() == '-') {
+            read_char();
+        }
+        if (input.peek() == '0') {
+            read_char();
+        } else {
+            read_digits();
+        }
+        bool is_int = true;
+        if (input.peek() == '.') {
+            read_char();
+            read_digits();
+            is_int = false;
+        }
+        if (int ch = input.peek(); ch == 'e' || ch == 'E') {
+            read_char();
+            if (ch = input.peek(); ch == '+' || ch == '-') {
+                read_char();
+            }
+            read_digits();
+            is_int = false;
+        }
+
+        try {
+            if (is_int) {
+                try {
+                    return json::Node(std::stoi(parsed_num));
+                } catch (...) {
+                    // При переполнении int число читается как double
+                }
+            }
+            return json::Node(std::stod(parsed_num));
+        } catch (...) {
+            throw ParsingError("Failed to convert " + parsed_num + " to number");
+        }
+    }
+
+    inline std::string LoadString(std::istream& input) {
+        auto it = std::istreambuf_iterator<char>(input);
+        auto end = std::istreambuf_iterator<char>();
+        std::string s;
+        while (true) {
+            if (it == end) {
+                throw ParsingError("String parsing error");
+            }
+            const char ch = *it;
+            if (ch == '"') {
+                ++it;
+                break;
+            } else if (ch == '\\') {
+                ++it;
+                if (it == end) {
+                    throw ParsingError("String parsing error");
+                }
+                const char escaped_char = *it;
+                switch (escaped_char) {
+                    case 'n': s.push_back('\n'); break;
+                    case 't': s.push_back('\t'); break;
+                    case 'r': s.push_back('\r'); break;
+                    case '"': s.push_back('"'); break;
+                    case '\\': s.push_back('\\'); break;
+                    default:
+                        throw ParsingError(std::string("Unrecognized escape sequence \\") + escaped_char);
+                }
+            } else if (ch == '\n' || ch == '\r') {
+                throw ParsingError("Unexpected end of line");
+            } else {
+                s.push_back(ch);
+            }
+            ++it;
+        }
+        return s;
+    }
+
+    inline json::Node LoadDict(std::istream& input) {
+        json::Dict result;
+        if (input.peek() == -1) {
+            throw ParsingError("Unexpected end of input");
+        }
+        for (char c; input >> c && c != '}';) {
+            if (c == ',') {
+                input >> c;
+            }
+            std::string key = LoadString(input);
+            input >> c;
+            result.insert({std::move(key), LoadNode(input)});
+        }
+        return json::Node(std::move(result));
+    }
+
+    inline json::Node LoadNode(std::istream& input) {
+        char c = 0;
+        input >> c;
+        switch (c) {
+            case 'n':
+                input.putback(c);
+                return LoadNull(input);
+            case 't':
+            case 'f':
+                input.putback(c);
+                return LoadBool(input);
+            case '[':
+                return LoadArray(input);
+            case '{':
+                return LoadDict(input);
+            case '"':
+                return json::Node(LoadString(input));
+            default:
+                if (std::isdigit(static_cast<unsigned char>(c)) || c == '-') {
+                    input.putback(c);
+                    return LoadNumber(input);
+                }
+                throw ParsingError("Error while parsing JSON, wrong argument - node");
+        }
+    }
+
+    inline json::Document Load(std::istream& input) {
+        return json::Document{LoadNode(input)};
+    }
+
+}
@@ -0,0 +1,148 @@
+// Нагрузочная проверка параллельных ответов на stat_requests.
+// Синтетический каталог отвечает на смешанный поток запросов всех типов при разном
+// числе потоков. Ответы каждого прогона сравниваются с ответами в одном потоке,
+// печатается время прогона и ускорение относительно одного потока.
+//
+// Проверка гонок (ThreadSanitizer), из корня репозитория:
+//   g++ -std=c++17 -O1 -g -fsanitize=thread -pthread -Itransport-catalogue -o query_stress benchmarks/query_stress.cpp $(ls transport-catalogue/*.cpp | grep -v '/main\.cpp')
+//   ./query_stress 300 20000 2
+// Замер масштабирования - та же команда с -O2 вместо -O1 -g -fsanitize=thread:
+//   ./query_stress [остановок, по умолчанию 600] [запросов, 100000] [повторов, 3]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "request_handler.h"
+
+namespace {
+
+    template <typename Function>
+    double MeasureSeconds(Function function) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string StopName(size_t index) {
+        return "Stop " + std::to_string(index);
+    }
+
+    // Остановки на сетке, маршруты идут по каждой второй строке и каждому второму столбцу
+    std::string MakeDocument(size_t stop_count, size_t request_count) {
+        std::mt19937 generator(42);
+        const size_t side = std::max<size_t>(2, static_cast<size_t>(std::sqrt(stop_count)));
+        stop_count = side * side;
+        std::uniform_int_distribution<size_t> stop(0, stop_count - 1);
+        std::uniform_int_distribution<int> distance(300, 3000);
+        std::uniform_real_distribution<double> latitude(55.58, 55.92);
+        std::uniform_real_distribution<double> longitude(37.36, 37.84);
+
+        std::ostringstream out;
+        out.precision(10);
+        out << R"({"base_requests": [)";
+        for (size_t i = 0; i < stop_count; ++i) {
+            out << (i ? ", " : "") << R"({"type": "Stop", "name": ")" << StopName(i)
+                << R"(", "latitude": )" << 55.58 + 0.34 * (i / side) / side
+                << R"(, "longitude": )" << 37.36 + 0.48 * (i % side) / side
+                << R"(, "road_distances": {)";
+            if (i % side + 1 < side) {
+                out << '"' << StopName(i + 1) << R"(": )" << distance(generator);
+            }
+            out << "}}";
+        }
+        for (size_t line = 0; line < side; line += 2) {
+            for (const bool row : {true, false}) {
+                out << R"(, {"type": "Bus", "name": ")" << (row ? "R" : "C") << line
+                    << R"(", "is_roundtrip": false, "stops": [)";
+                for (size_t i = 0; i < side; ++i) {
+                    out << (i ? ", " : "") << '"' << StopName(row ? line * side + i : i * side + line) << '"';
+                }
+                out << "]}";
+            }
+        }
+        out << R"(], "routing_settings": {"bus_wait_time": 6, "bus_velocity": 40},
+            "render_settings": {"width": 1200, "height": 1200, "padding": 50, "line_width": 14,
+                "stop_radius": 5, "bus_label_font_size": 20, "bus_label_offset": [7, 15],
+                "stop_label_font_size": 18, "stop_label_offset": [7, -3],
+                "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3,
+                "color_palette": ["green", [255, 160, 0], "red"]},
+            "stat_requests": [)";
+
+        std::uniform_int_distribution<int> kind(0, 99);
+        for (size_t id = 0; id < request_count; ++id) {
+            out << (id ? ", " : "") << R"({"id": )" << id << ", ";
+            const int k = kind(generator);
+            if (k < 25) {
+                out << R"("type": "Stop", "name": ")" << StopName(stop(generator)) << '"';
+            } else if (k < 45) {
+                out << R"("type": "Bus", "name": ")" << (k % 2 ? "R" : "C") << stop(generator) % side << '"';
+            } else if (k < 85) {
+                out << R"("type": "Route", "from": ")" << StopName(stop(generator))
+                    << R"(", "to": ")" << StopName(stop(generator)) << '"';
+            } else if (k < 92) {
+                out << R"("type": "NearestStops", "count": 5, "latitude": )" << latitude(generator)
+                    << R"(, "longitude": )" << longitude(generator);
+            } else if (k < 96) {
+                const double lat = latitude(generator);
+                const double lng = longitude(generator);
+                out << R"("type": "StopsInBox", "min_latitude": )" << lat << R"(, "min_longitude": )" << lng
+                    << R"(, "max_latitude": )" << lat + 0.03 << R"(, "max_longitude": )" << lng + 0.03;
+            } else if (k < 99) {
+                out << R"("type": "StopSearch", "count": 10, "prefix": "Stop )" << stop(generator) % 10 << '"';
+            } else {
+                out << R"("type": "Map")";
+            }
+            out << '}';
+        }
+        out << "]}";
+        return out.str();
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    const size_t stop_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 600;
+    const size_t request_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100'000;
+    const size_t repeat_count = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 3;
+
+    transport::Catalogue catalogue;
+    request::Handler handler(catalogue);
+    std::istringstream input(MakeDocument(stop_count, request_count));
+    handler.ReadJson(input);
+    handler.FillCatalogue();
+
+    std::string expected;
+    double serial_seconds = 0;
+    bool success = true;
+    const size_t max_threads = std::max(8u, std::thread::hardware_concurrency());
+    for (size_t thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        handler.SetThreadCount(thread_count);
+        double best = 0;
+        for (size_t repeat = 0; repeat < repeat_count; ++repeat) {
+            std::ostringstream output;
+            const double seconds = MeasureSeconds([&]{
+                handler.PrintJson(output);
+            });
+            best = repeat == 0 ? seconds : std::min(best, seconds);
+            if (expected.empty()) {
+                expected = output.str();
+            } else if (output.str() != expected) {
+                std::printf("threads %2zu: output differs from the single-threaded run\n", thread_count);
+                success = false;
+            }
+        }
+        if (thread_count == 1) {
+            serial_seconds = best;
+        }
+        std::printf("threads %2zu   %8.3f s   x%.2f\n", thread_count, best, serial_seconds / best);
+    }
+    return success ? 0 : 1;
+}
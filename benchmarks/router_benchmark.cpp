@@ -0,0 +1,85 @@
+// Бенчмарк таблицы маршрутов graph::Router при разных memory::PagePolicy:
+// время построения таблицы и время ответа на случайные запросы BuildRoute.
+// Сборка из корня репозитория:
+//   g++ -std=c++17 -O2 -Itransport-catalogue benchmarks/router_benchmark.cpp
+// Запуск: ./a.out [число вершин, по умолчанию 1000]
+//
+// Граф похож на граф маршрутизатора: кольцо, чтобы все вершины были достижимы,
+// и несколько случайных рёбер из каждой вершины. Запросы берут случайные пары
+// вершин, поэтому обращения к таблице разбросаны по всем её строкам - именно
+// здесь крупные страницы уменьшают промахи TLB. Политика EXPLICIT_HUGE_PAGES
+// без зарезервированных страниц hugetlb ведёт себя как TRANSPARENT_HUGE_PAGES
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "router.h"
+
+namespace {
+
+    template <typename Function>
+    double MeasureSeconds(Function function) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    graph::DirectedWeightedGraph<double> MakeGraph(size_t vertex_count) {
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<size_t> vertex(0, vertex_count - 1);
+        std::uniform_real_distribution<double> weight(1.0, 30.0);
+        graph::DirectedWeightedGraph<double> result(vertex_count);
+        for (graph::VertexId from = 0; from < vertex_count; ++from) {
+            result.AddEdge({from, (from + 1) % vertex_count, weight(generator)});
+            for (int i = 0; i < 3; ++i) {
+                result.AddEdge({from, vertex(generator), weight(generator)});
+            }
+        }
+        return result;
+    }
+
+    void Benchmark(const char* name, memory::PagePolicy policy,
+                   const graph::DirectedWeightedGraph<double>& graph,
+                   const std::vector<std::pair<graph::VertexId, graph::VertexId>>& queries) {
+        std::optional<graph::Router<double>> router;
+        const double build = MeasureSeconds([&]{
+            router.emplace(graph, policy);
+        });
+        double total_weight = 0;
+        size_t total_edges = 0;
+        const double query = MeasureSeconds([&]{
+            for (const auto& [from, to] : queries) {
+                if (const auto route = router->BuildRoute(from, to)) {
+                    total_weight += route->weight;
+                    total_edges += route->edges.size();
+                }
+            }
+        });
+        std::printf("%-12s table %7.1f MB   build %7.3f s   query %7.1f ns   (%.0f, %zu)\n",
+                    name, router->GetMemoryUsage().bytes / 1048576.0, build,
+                    query * 1e9 / queries.size(), total_weight, total_edges);
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    const size_t vertex_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    const auto graph = MakeGraph(vertex_count);
+
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<size_t> vertex(0, vertex_count - 1);
+    std::vector<std::pair<graph::VertexId, graph::VertexId>> queries(1'000'000);
+    for (auto& [from, to] : queries) {
+        from = vertex(generator);
+        to = vertex(generator);
+    }
+
+    Benchmark("default", memory::PagePolicy::DEFAULT, graph, queries);
+    Benchmark("transparent", memory::PagePolicy::TRANSPARENT_HUGE_PAGES, graph, queries);
+    Benchmark("explicit", memory::PagePolicy::EXPLICIT_HUGE_PAGES, graph, queries);
+}
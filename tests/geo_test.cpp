@@ -0,0 +1,119 @@
+// Проверка geo::ComputeDistances против geo::ComputeDistance на случайных парах точек:
+// городских (до нескольких километров) и произвольных на всей сфере.
+// Сборка и запуск из корня репозитория:
+//   g++ -std=c++17 -O2 -Itransport-catalogue -o geo_test tests/geo_test.cpp transport-catalogue/geo.cpp
+//   ./geo_test
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "geo.h"
+
+namespace {
+
+    // Ближе этого расстояния сравнивается абсолютная разница, дальше - относительная
+    const double NEAR_DISTANCE = 10.0;
+    const double MAX_RELATIVE_ERROR = 1e-10;
+    const double MAX_ABSOLUTE_ERROR = 1e-6;
+
+    bool Check(const char* name, const std::vector<geo::Coordinates>& points) {
+        std::vector<double> sin_lat;
+        std::vector<double> cos_lat;
+        std::vector<double> lng;
+        for (const geo::Coordinates& point : points) {
+            sin_lat.push_back(geo::SinLatitude(point.lat));
+            cos_lat.push_back(geo::CosLatitude(point.lat));
+            lng.push_back(point.lng);
+        }
+        // Соседние точки и каждая точка с собой
+        std::vector<uint32_t> from;
+        std::vector<uint32_t> to;
+        for (uint32_t i = 0; i + 1 < points.size(); ++i) {
+            from.push_back(i);
+            to.push_back(i + 1);
+            from.push_back(i);
+            to.push_back(i);
+        }
+        std::vector<double> batch(from.size());
+        geo::ComputeDistances(sin_lat.data(), cos_lat.data(), lng.data(), from.data(), to.data(),
+                              batch.data(), batch.size());
+
+        double max_relative = 0.0;
+        double max_absolute = 0.0;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            // Пакет из одной пары считается без AVX2 и должен совпасть бит в бит
+            double single = 0.0;
+            geo::ComputeDistances(sin_lat.data(), cos_lat.data(), lng.data(), &from[i], &to[i], &single, 1);
+            if (single != batch[i] && !(std::isnan(single) && std::isnan(batch[i]))) {
+                std::printf("FAIL %s: pair %zu, batch %.17g, single %.17g\n", name, i, batch[i], single);
+                return false;
+            }
+            // Точка с собой может дать аргумент acos чуть больше 1, и тогда NaN
+            // должен получиться так же, как у ComputeDistance
+            const double expected = geo::ComputeDistance(points[from[i]], points[to[i]]);
+            if (std::isnan(expected) || std::isnan(batch[i])) {
+                if (std::isnan(expected) != std::isnan(batch[i])) {
+                    std::printf("FAIL %s: pair %zu, batch %.17g, expected %.17g\n", name, i, batch[i], expected);
+                    return false;
+                }
+                continue;
+            }
+            const double error = std::abs(batch[i] - expected);
+            if (expected < NEAR_DISTANCE) {
+                max_absolute = std::max(max_absolute, error);
+            } else {
+                max_relative = std::max(max_relative, error / expected);
+            }
+        }
+        if (max_relative > MAX_RELATIVE_ERROR || max_absolute > MAX_ABSOLUTE_ERROR) {
+            std::printf("FAIL %s: relative %.3g, absolute %.3g m\n", name, max_relative, max_absolute);
+            return false;
+        }
+        std::printf("ok   %s: relative %.3g, absolute %.3g m\n", name, max_relative, max_absolute);
+        return true;
+    }
+
+}
+
+int main() {
+    const size_t count = 200'000;
+    std::mt19937 generator(42);
+
+    // Серии остановок, как на маршруте, с редкими переходами в другой район;
+    // на коротких шагах аргумент acos ближе всего к 1, и ошибка cos заметнее всего
+    std::uniform_real_distribution<double> city_lat(55.5, 56.0);
+    std::uniform_real_distribution<double> city_lng(37.3, 37.9);
+    auto make_route = [&](double max_step) {
+        std::uniform_real_distribution<double> step(-max_step, max_step);
+        std::vector<geo::Coordinates> result;
+        geo::Coordinates point;
+        for (size_t i = 0; i < count; ++i) {
+            if (i % 50 == 0) {
+                point = {city_lat(generator), city_lng(generator)};
+            } else {
+                point = {point.lat + step(generator), point.lng + step(generator)};
+            }
+            result.push_back(point);
+        }
+        return result;
+    };
+    const std::vector<geo::Coordinates> city = make_route(0.02);
+    const std::vector<geo::Coordinates> short_hops = make_route(0.001);
+
+    std::vector<geo::Coordinates> sphere;
+    std::uniform_real_distribution<double> any_lat(-90.0, 90.0);
+    std::uniform_real_distribution<double> any_lng(-180.0, 180.0);
+    for (size_t i = 0; i < count; ++i) {
+        sphere.push_back({any_lat(generator), any_lng(generator)});
+    }
+
+    bool success = true;
+    success &= Check("city", city);
+    success &= Check("short hops", short_hops);
+    success &= Check("sphere", sphere);
+    return success ? 0 : 1;
+}
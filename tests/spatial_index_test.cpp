@@ -0,0 +1,96 @@
+// Проверка spatial::StopIndex: ближайшие остановки при равных расстояниях должны
+// выбираться и упорядочиваться по domain::NameLess, независимо от порядка добавления.
+// Сборка и запуск из корня репозитория:
+//   g++ -std=c++17 -O2 -Itransport-catalogue -o spatial_index_test tests/spatial_index_test.cpp transport-catalogue/spatial_index.cpp transport-catalogue/geo.cpp
+//   ./spatial_index_test
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "spatial_index.h"
+
+namespace {
+
+    struct Point {
+        std::string name;
+        geo::Coordinates coordinates;
+    };
+
+    std::vector<std::string> Nearest(const std::vector<Point>& points, geo::Coordinates target, size_t count) {
+        std::deque<domain::Stop> stops;
+        std::vector<domain::Stop*> all_stops;
+        std::vector<double> lat;
+        std::vector<double> lng;
+        for (const Point& point : points) {
+            domain::Stop& stop = stops.emplace_back(point.name, point.coordinates);
+            stop.id = static_cast<uint32_t>(all_stops.size());
+            all_stops.push_back(&stop);
+            lat.push_back(point.coordinates.lat);
+            lng.push_back(point.coordinates.lng);
+        }
+        spatial::StopIndex index;
+        index.Build(all_stops, lat, lng);
+
+        std::vector<std::string> result;
+        for (const domain::Stop* stop : index.GetNearest(target, count)) {
+            result.emplace_back(stop->name);
+        }
+        return result;
+    }
+
+    std::string Join(const std::vector<std::string>& names) {
+        std::string result;
+        for (const std::string& name : names) {
+            result += (result.empty() ? "" : ", ") + name;
+        }
+        return "[" + result + "]";
+    }
+
+    // Ответ не должен зависеть от порядка добавления остановок
+    bool Check(const char* name, std::vector<Point> points, geo::Coordinates target, size_t count,
+               const std::vector<std::string>& expected) {
+        std::sort(points.begin(), points.end(), [](const Point& lhs, const Point& rhs){
+            return lhs.name < rhs.name;
+        });
+        do {
+            const std::vector<std::string> found = Nearest(points, target, count);
+            if (found != expected) {
+                std::printf("FAIL %s\nfound:    %s\nexpected: %s\n", name, Join(found).c_str(), Join(expected).c_str());
+                return false;
+            }
+        } while (std::next_permutation(points.begin(), points.end(), [](const Point& lhs, const Point& rhs){
+            return lhs.name < rhs.name;
+        }));
+        std::printf("ok   %s\n", name);
+        return true;
+    }
+
+}
+
+int main() {
+    const geo::Coordinates center = {55.6, 37.6};
+    const geo::Coordinates near = {55.6001, 37.6};
+    bool success = true;
+
+    success &= Check("co-located stops",
+        {{"z", center}, {"y", center}, {"x", center}, {"w", center}, {"v", center}, {"a", center}},
+        center, 2, {"a", "v"});
+    success &= Check("co-located stops away from the target",
+        {{"z", near}, {"y", near}, {"x", near}, {"w", near}, {"v", near}, {"a", near}},
+        center, 3, {"a", "v", "w"});
+    success &= Check("tie at the last place",
+        {{"far", {55.7, 37.6}}, {"d", near}, {"c", near}, {"b", near}, {"first", center}},
+        center, 3, {"first", "b", "c"});
+    // Байты имён сравниваются без знака: кириллица после латиницы
+    success &= Check("non-ASCII names",
+        {{"\xD0\x96", center}, {"b", center}, {"a", center}},
+        center, 2, {"a", "b"});
+    success &= Check("fewer stops than count",
+        {{"b", near}, {"a", center}},
+        center, 5, {"a", "b"});
+
+    return success ? 0 : 1;
+}
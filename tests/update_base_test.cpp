@@ -0,0 +1,188 @@
+// Проверка update_base: база, изменённая патчем, должна отвечать так же, как база,
+// построенная заново из итоговых данных: для изменений расстояний, остановок и маршрутов.
+// Сборка и запуск из корня репозитория:
+//   g++ -std=c++17 -O2 -pthread -Itransport-catalogue -o update_base_test tests/update_base_test.cpp $(ls transport-catalogue/*.cpp | grep -v '/main\.cpp')
+//   ./update_base_test
+
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "request_handler.h"
+
+namespace {
+
+    const std::string SERIALIZATION = R"("serialization_settings": {"file": "update_base_test.db"})";
+
+    const std::string SETTINGS = R"(
+        "routing_settings": {"bus_wait_time": 6, "bus_velocity": 40},
+        "render_settings": {"width": 600, "height": 400, "padding": 50, "line_width": 14,
+            "stop_radius": 5, "bus_label_font_size": 20, "bus_label_offset": [7, 15],
+            "stop_label_font_size": 18, "stop_label_offset": [7, -3],
+            "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3,
+            "color_palette": ["green", [255, 160, 0], "red"]})";
+
+    // Запросы ко всем остановкам и маршрутам, которые встречаются в случаях ниже
+    const std::string STAT_REQUESTS = R"("stat_requests": [
+        {"id": 1, "type": "Bus", "name": "1"},
+        {"id": 2, "type": "Route", "from": "A", "to": "B"},
+        {"id": 3, "type": "Route", "from": "B", "to": "A"},
+        {"id": 4, "type": "Route", "from": "A", "to": "C"},
+        {"id": 5, "type": "Bus", "name": "2"},
+        {"id": 6, "type": "Stop", "name": "A"},
+        {"id": 7, "type": "Stop", "name": "B"},
+        {"id": 8, "type": "Stop", "name": "C"},
+        {"id": 9, "type": "Stop", "name": "D"},
+        {"id": 10, "type": "Route", "from": "C", "to": "A"},
+        {"id": 11, "type": "Route", "from": "A", "to": "D"},
+        {"id": 12, "type": "StopsInBox", "min_latitude": 55.5, "min_longitude": 37.5,
+         "max_latitude": 55.7, "max_longitude": 37.7},
+        {"id": 13, "type": "Map"}])";
+
+    std::string Stop(const std::string& name, double longitude, const std::string& distances) {
+        return R"({"type": "Stop", "name": ")" + name + R"(", "latitude": 55.6, "longitude": )"
+            + std::to_string(longitude) + R"(, "road_distances": {)" + distances + "}}";
+    }
+
+    std::string Bus(const std::string& name, const std::string& stops, bool is_roundtrip = false) {
+        return R"({"type": "Bus", "name": ")" + name + R"(", "stops": [)" + stops
+            + R"(], "is_roundtrip": )" + (is_roundtrip ? "true" : "false") + "}";
+    }
+
+    std::string BaseRequests(const std::vector<std::string>& records) {
+        std::string result;
+        for (const std::string& record : records) {
+            result += (result.empty() ? "" : ", ") + record;
+        }
+        return R"("base_requests": [)" + result + "]";
+    }
+
+    std::string BaseRequests(const std::string& stop_a, const std::string& stop_b) {
+        return BaseRequests({stop_a, stop_b, Bus("1", R"("A", "B")")});
+    }
+
+    std::string Run(const std::string& mode, const std::string& document) {
+        transport::Catalogue catalogue;
+        request::Handler handler(catalogue);
+        std::istringstream input(document);
+        handler.ReadJson(input);
+        std::ostringstream output;
+        if (mode == "make_base") {
+            handler.MakeBase();
+        } else if (mode == "update_base") {
+            handler.UpdateBase();
+        } else {
+            handler.LoadBase();
+            handler.PrintJson(output);
+        }
+        return output.str();
+    }
+
+    struct Case {
+        const char* name;
+        std::string base;
+        std::string patch;
+        std::string expected_base;
+        // Патч должен быть отклонён с std::invalid_argument, не изменив базу
+        bool rejected = false;
+    };
+
+    bool Check(const Case& test) {
+        Run("make_base", "{" + test.base + ", " + SETTINGS + ", " + SERIALIZATION + "}");
+        bool rejected = false;
+        try {
+            Run("update_base", R"({"base_requests": [)" + test.patch + "], " + SERIALIZATION + "}");
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        if (rejected != test.rejected) {
+            std::printf("FAIL %s: patch %s\n", test.name, rejected ? "rejected" : "accepted");
+            return false;
+        }
+        const std::string patched = Run("process_requests", "{" + STAT_REQUESTS + ", " + SERIALIZATION + "}");
+
+        Run("make_base", "{" + test.expected_base + ", " + SETTINGS + ", " + SERIALIZATION + "}");
+        const std::string fresh = Run("process_requests", "{" + STAT_REQUESTS + ", " + SERIALIZATION + "}");
+
+        if (patched != fresh) {
+            std::printf("FAIL %s\npatched:\n%s\nfresh:\n%s\n", test.name, patched.c_str(), fresh.c_str());
+            return false;
+        }
+        std::printf("ok   %s\n", test.name);
+        return true;
+    }
+
+}
+
+int main() {
+    const std::string a = Stop("A", 37.60, R"("B": 1000)");
+    const std::string b = Stop("B", 37.61, R"("C": 1500)");
+    const std::string c = Stop("C", 37.62, R"("B": 1200)");
+    const std::string d = Stop("D", 37.63, R"("C": 900)");
+    const std::string bus_1 = Bus("1", R"("A", "B", "C")");
+    const std::string bus_2 = Bus("2", R"("C", "D", "C")", true);
+
+    const std::vector<Case> cases = {
+        // Обратное направление, не заданное явно, должно следовать за прямым
+        {"replace implied reverse",
+         BaseRequests(Stop("A", 37.60, R"("B": 1000)"), Stop("B", 37.61, "")),
+         R"({"type": "Distance", "action": "replace", "from": "A", "to": "B", "distance": 2000})",
+         BaseRequests(Stop("A", 37.60, R"("B": 2000)"), Stop("B", 37.61, ""))},
+        {"remove implied reverse",
+         BaseRequests(Stop("A", 37.60, R"("B": 1000)"), Stop("B", 37.61, "")),
+         R"({"type": "Distance", "action": "remove", "from": "A", "to": "B"})",
+         BaseRequests(Stop("A", 37.60, ""), Stop("B", 37.61, ""))},
+        {"remove explicit reverse",
+         BaseRequests(Stop("A", 37.60, R"("B": 1000)"), Stop("B", 37.61, R"("A": 3000)")),
+         R"({"type": "Distance", "action": "remove", "from": "B", "to": "A"})",
+         BaseRequests(Stop("A", 37.60, R"("B": 1000)"), Stop("B", 37.61, ""))},
+        {"add explicit reverse",
+         BaseRequests(Stop("A", 37.60, R"("B": 1000)"), Stop("B", 37.61, "")),
+         R"({"type": "Distance", "from": "B", "to": "A", "distance": 3000})",
+         BaseRequests(Stop("A", 37.60, R"("B": 1000)"), Stop("B", 37.61, R"("A": 3000)"))},
+        // Замена остановки с road_distances заменяет все её расстояния, а не дополняет их
+        {"replace stop distances",
+         BaseRequests({a, b, Stop("C", 37.62, ""), bus_1}),
+         R"({"type": "Stop", "action": "replace", "name": "B", "latitude": 55.6, "longitude": 37.61,
+             "road_distances": {"A": 700}})",
+         BaseRequests({a, Stop("B", 37.61, R"("A": 700)"), Stop("C", 37.62, ""), bus_1})},
+        {"move stop",
+         BaseRequests({a, b, c, d, bus_1, bus_2}),
+         R"({"type": "Stop", "action": "replace", "name": "C", "latitude": 55.6, "longitude": 37.65})",
+         BaseRequests({a, b, Stop("C", 37.65, R"("B": 1200)"), d, bus_1, bus_2})},
+        {"remove stop",
+         BaseRequests({a, b, c, d, bus_1}),
+         R"({"type": "Stop", "action": "remove", "name": "D"})",
+         BaseRequests({a, b, c, bus_1})},
+        {"remove stop used by a bus",
+         BaseRequests({a, b, c, d, bus_1, bus_2}),
+         R"({"type": "Stop", "action": "remove", "name": "D"})",
+         BaseRequests({a, b, c, d, bus_1, bus_2}),
+         true},
+        {"remove stop with its bus",
+         BaseRequests({a, b, c, d, bus_1, bus_2}),
+         R"({"type": "Stop", "action": "remove", "name": "D"}, {"type": "Bus", "action": "remove", "name": "2"})",
+         BaseRequests({a, b, c, bus_1})},
+        {"replace bus",
+         BaseRequests({a, b, c, d, bus_1, bus_2}),
+         R"({"type": "Bus", "action": "replace", "name": "1", "stops": ["A", "B", "C", "D", "A"], "is_roundtrip": true})",
+         BaseRequests({a, b, c, d, Bus("1", R"("A", "B", "C", "D", "A")", true), bus_2})},
+        {"remove bus",
+         BaseRequests({a, b, c, d, bus_1, bus_2}),
+         R"({"type": "Bus", "action": "remove", "name": "1"})",
+         BaseRequests({a, b, c, d, bus_2})},
+        {"add stop and bus",
+         BaseRequests({a, b, c, bus_1}),
+         d + ", " + bus_2,
+         BaseRequests({a, b, c, d, bus_1, bus_2})},
+    };
+
+    bool success = true;
+    for (const Case& test : cases) {
+        success &= Check(test);
+    }
+    std::remove("update_base_test.db");
+    return success ? 0 : 1;
+}
@@ -1,17 +1,114 @@
 #include "domain.h"
 
 namespace domain {
-    size_t StopPairHasher::operator()(const std::pair<domain::Stop*,domain::Stop*>& stop_pair) const {
-        std::hash<std::string> hash_;
-        std::size_t hash1 = hash_(stop_pair.first->name);
-        std::size_t hash2 = hash_(stop_pair.second->name);
-        return (hash1 + 11*hash2);
-    }
-
-    size_t PairHasher::operator()(const std::pair<std::string,std::string>& stop_pair)const{
-        std::hash<std::string> hash_;
+    size_t PairHasher::operator()(const std::pair<std::string_view,std::string_view>& stop_pair)const{
+        std::hash<std::string_view> hash_;
         std::size_t hash1 = hash_(stop_pair.first);
         std::size_t hash2 = hash_(stop_pair.second);
         return (hash1 + 7*hash2);
     }
+
+// ---------- DistanceTable ---------
+
+    uint64_t DistanceTable::MakeKey(uint32_t from, uint32_t to) {
+        return (static_cast<uint64_t>(from) << 32) | to;
+    }
+
+    size_t DistanceTable::HomeSlot(uint64_t key) const {
+        // Фибоначчиево хеширование, ёмкость таблицы - степень двойки
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (slots_.size() - 1);
+    }
+
+    size_t DistanceTable::FindSlot(uint64_t key) const {
+        const size_t mask = slots_.size() - 1;
+        size_t index = HomeSlot(key);
+        while (slots_[index].key != key && slots_[index].key != EMPTY_KEY) {
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    void DistanceTable::Rehash(size_t capacity) {
+        std::vector<Slot> old = std::move(slots_);
+        slots_.assign(capacity, Slot{});
+        for (const Slot& slot : old) {
+            if (slot.key != EMPTY_KEY) {
+                slots_[FindSlot(slot.key)] = slot;
+            }
+        }
+    }
+
+    void DistanceTable::Reserve(size_t count) {
+        size_t capacity = 16;
+        while (capacity < count * 2) {
+            capacity *= 2;
+        }
+        if (capacity > slots_.size()) {
+            Rehash(capacity);
+        }
+    }
+
+    void DistanceTable::Set(uint32_t from, uint32_t to, double distance) {
+        Reserve(size_ + 1);
+        Slot& slot = slots_[FindSlot(MakeKey(from, to))];
+        if (slot.key == EMPTY_KEY) {
+            slot.key = MakeKey(from, to);
+            ++size_;
+        }
+        slot.distance = distance;
+    }
+
+    bool DistanceTable::Insert(uint32_t from, uint32_t to, double distance) {
+        Reserve(size_ + 1);
+        Slot& slot = slots_[FindSlot(MakeKey(from, to))];
+        if (slot.key != EMPTY_KEY) {
+            return false;
+        }
+        slot.key = MakeKey(from, to);
+        slot.distance = distance;
+        ++size_;
+        return true;
+    }
+
+    std::optional<double> DistanceTable::Get(uint32_t from, uint32_t to) const {
+        if (slots_.empty()) {
+            return std::nullopt;
+        }
+        const Slot& slot = slots_[FindSlot(MakeKey(from, to))];
+        if (slot.key == EMPTY_KEY) {
+            return std::nullopt;
+        }
+        return slot.distance;
+    }
+
+    bool DistanceTable::Erase(uint32_t from, uint32_t to) {
+        if (slots_.empty()) {
+            return false;
+        }
+        size_t hole = FindSlot(MakeKey(from, to));
+        if (slots_[hole].key == EMPTY_KEY) {
+            return false;
+        }
+        // Запись из хвоста цепочки переезжает в дыру, если дыра лежит
+        // между её начальной ячейкой и текущим местом
+        const size_t mask = slots_.size() - 1;
+        for (size_t index = (hole + 1) & mask; slots_[index].key != EMPTY_KEY; index = (index + 1) & mask) {
+            const size_t home = HomeSlot(slots_[index].key);
+            if (((index - home) & mask) >= ((index - hole) & mask)) {
+                slots_[hole] = slots_[index];
+                hole = index;
+            }
+        }
+        slots_[hole] = Slot{};
+        --size_;
+        return true;
+    }
+
+    size_t DistanceTable::Size() const {
+        return size_;
+    }
+
+    memory::Usage DistanceTable::GetMemoryUsage(std::string component) const {
+        return {std::move(component), size_ * sizeof(Slot), (slots_.capacity() - size_) * sizeof(Slot)};
+    }
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <set>
 #include <variant>
 #include <optional>
@@ -9,29 +11,32 @@
 
 #include "geo.h"
 #include "graph.h"
+#include "memory_usage.h"
+#include "page_allocator.h"
 
 namespace domain {
         struct Stop {
 
-            Stop(const std::string& name_, const geo::Coordinates& coordinates_)
+            Stop(std::string_view name_, const geo::Coordinates& coordinates_)
                 : name(name_)
                 , coordinates(coordinates_){}	
 
-            Stop(const std::string& name_, const double& latitude_, const double& longitude_)
+            Stop(std::string_view name_, const double& latitude_, const double& longitude_)
                 : name(name_){
                     coordinates.lat = latitude_;
                     coordinates.lng = longitude_;
                 }
 
-            std::string name = "";
+            std::string_view name; // указывает в таблицу имён каталога
             geo::Coordinates coordinates = {0.0,0.0};
-            std::set<std::string_view> buses;
+            uint32_t id = 0; // плотный номер остановки, выдаётся в Catalogue::AddStop
         };
 
         struct Bus {
-            std::string name = "";
+            std::string_view name; // указывает в таблицу имён каталога
             std::vector<Stop*> stops;
             bool is_roundtrip;
+            uint32_t id = 0; // плотный номер маршрута, выдаётся в Catalogue::AddBus
             int stops_count = 0;
             int unique_stops = 0;
             double length = 0.0;	
@@ -39,25 +44,91 @@ namespace domain {
             double curvature = 0.0;
         };
 
-    struct StopPairHasher {
-        public:
-            size_t operator()(const std::pair<domain::Stop*,domain::Stop*>& stop_pair)const;
+    // Порядок остановок и маршрутов в ответах: имена сравниваются побайтово,
+    // байты - без знака, как в std::string_view
+    struct NameLess {
+        template <typename T>
+        bool operator()(const T* lhs, const T* rhs) const {
+            return lhs->name < rhs->name;
+        }
     };
 
     struct PairHasher {
         public:
-            size_t operator()(const std::pair<std::string,std::string>& stop_pair)const;
+            size_t operator()(const std::pair<std::string_view,std::string_view>& stop_pair)const;
     };
 
-    typedef std::unordered_map<std::pair<std::string,std::string>,double,PairHasher> DistancesStringMap;
-    typedef std::unordered_map<std::pair<Stop*,Stop*>,double,StopPairHasher> DistancesStopMap;
+    typedef std::unordered_map<std::pair<std::string_view,std::string_view>,double,PairHasher> DistancesStringMap;
+
+    // Таблица расстояний с открытой адресацией, ключ - упакованная пара номеров остановок
+    class DistanceTable {
+        public:
+            void Reserve(size_t count);
+
+            void Set(uint32_t from, uint32_t to, double distance);
+
+            // Добавляет расстояние, только если для пары его ещё нет
+            bool Insert(uint32_t from, uint32_t to, double distance);
+
+            std::optional<double> Get(uint32_t from, uint32_t to) const;
+
+            // Удаляет запись, не оставляя пометок в таблице: хвост цепочки сдвигается назад
+            bool Erase(uint32_t from, uint32_t to);
+
+            size_t Size() const;
+
+            memory::Usage GetMemoryUsage(std::string component) const;
+
+            // Вызывает func(from, to, distance) для каждой записи в порядке ячеек таблицы
+            template <typename Func>
+            void ForEach(Func func) const {
+                for (const Slot& slot : slots_) {
+                    if (slot.key != EMPTY_KEY) {
+                        func(static_cast<uint32_t>(slot.key >> 32), static_cast<uint32_t>(slot.key), slot.distance);
+                    }
+                }
+            }
+
+        private:
+            static constexpr uint64_t EMPTY_KEY = ~uint64_t{0};
+
+            struct Slot {
+                uint64_t key = EMPTY_KEY;
+                double distance = 0.0;
+            };
+
+            std::vector<Slot> slots_;
+            size_t size_ = 0;
+
+            static uint64_t MakeKey(uint32_t from, uint32_t to);
+            size_t HomeSlot(uint64_t key) const;
+            size_t FindSlot(uint64_t key) const;
+            void Rehash(size_t capacity);
+    };
 
     namespace command{
 
         struct BusDescription{
-            std::string name;
+            std::string_view name;
             bool is_roundtrip;
-            std::vector<std::string> stops;
+            std::vector<std::string_view> stops;
+        };
+
+        // Изменения уже загруженного каталога. Добавления идут обычным путём
+        // (stop_commands, bus_commands, distances), здесь - замены и удаления
+        struct Updates {
+            std::vector<Stop> moved_stops; // новые координаты существующих остановок
+            // Остановки, чьи заданные расстояния до других заменяются новыми из distances
+            std::vector<std::string_view> replaced_distances;
+            std::vector<std::string_view> removed_stops;
+            std::vector<BusDescription> replaced_buses;
+            std::vector<std::string_view> removed_buses;
+            std::vector<std::pair<std::string_view,std::string_view>> removed_distances;
+
+            bool Empty() const {
+                return moved_stops.empty() && replaced_distances.empty() && removed_stops.empty()
+                    && replaced_buses.empty() && removed_buses.empty() && removed_distances.empty();
+            }
         };
     }
 
@@ -75,6 +146,7 @@ namespace domain {
         struct Settings {
             int bus_wait_time = 6;
             double velocity = 40;
+            memory::PagePolicy route_table_policy = memory::PagePolicy::DEFAULT;
         };
         
         struct StopVertex {
@@ -97,7 +169,7 @@ namespace domain {
 
         struct ResponseItem {
             EdgeType type;
-            std::string name;
+            std::string_view name;
             std::optional<int> span_count;
             Time time;
         };
@@ -114,7 +186,10 @@ namespace domain {
             STOP,
             BUS,
             MAP,
-            ROUTE
+            ROUTE,
+            NEAREST_STOPS,
+            STOPS_IN_BOX,
+            STOP_SEARCH
         };
 
         struct Command{
@@ -122,6 +197,11 @@ namespace domain {
             std::string name;
             request::Type type;
             std::optional<std::string> to_name;
+            // NEAREST_STOPS: точка и число остановок; STOPS_IN_BOX: углы прямоугольника;
+            // STOP_SEARCH: префикс имени в name и число остановок
+            geo::Coordinates point = {0.0,0.0};
+            geo::Coordinates point_to = {0.0,0.0};
+            int count = 0;
         };
 
         struct Response{
@@ -130,6 +210,8 @@ namespace domain {
             Stop* stop_data = nullptr;
             Bus* bus_data = nullptr;
             Stop* stop_to = nullptr;
+            geo::Coordinates point = {0.0,0.0};
+            std::vector<Stop*> stops;
         };
     }
 
@@ -137,7 +219,9 @@ namespace domain {
         std::vector<Stop> stop_commands;
         std::vector<domain::command::BusDescription> bus_commands;
         DistancesStringMap distances;
+        domain::command::Updates updates;
         std::vector<domain::request::Command> requests;
+        std::optional<std::string> serialization_file;
     };
 
 }
\ No newline at end of file
@@ -2,11 +2,26 @@
 #include "geo.h"
 
 #include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace geo {
 
 const int EARTH_RADIUS = 6371000;
 
+// При сборке с -mfma компилятор сливает умножение и сложение в FMA. Аргумент acos
+// вблизи 1 от этого меняется на ulp, а расстояние в сотни метров - в пятом знаке,
+// поэтому расстояния считаются без слияния, одинаково при любых флагах
+#if defined(__GNUC__) && !defined(__clang__)
+#define NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define NO_FP_CONTRACT
+#endif
+
+NO_FP_CONTRACT
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
     const double dr = M_PI / 180.0;
@@ -15,4 +30,239 @@ double ComputeDistance(Coordinates from, Coordinates to) {
         * EARTH_RADIUS;
 }
 
-}  // namespace geo
\ No newline at end of file
+double SinLatitude(double lat) {
+    const double dr = M_PI / 180.0;
+    return std::sin(lat * dr);
+}
+
+double CosLatitude(double lat) {
+    const double dr = M_PI / 180.0;
+    return std::cos(lat * dr);
+}
+
+namespace {
+
+// Пакетный расчёт повторяет ComputeDistance, но cos и acos считаются не libm,
+// а многочленами из fdlibm (k_cos.c, k_sin.c, e_acos.c) без ветвлений: каждое
+// значение считается всеми ветвями, а нужная выбирается маской. Скалярная версия
+// и версия на AVX2 выполняют одни и те же операции в том же порядке, без FMA,
+// поэтому результат не зависит от процессора
+
+const double DR = M_PI / 180.0;
+const double TWO_OVER_PI = 6.36619772367581382433e-01;
+// pi/2 = PIO2_1 + PIO2_1T, у PIO2_1 33 значащих бита: n * PIO2_1 точно при n < 2^20
+const double PIO2_1 = 1.57079632673412561417e+00;
+const double PIO2_1T = 6.07710050650619224932e-11;
+
+const double C1 = 4.16666666666666019037e-02;
+const double C2 = -1.38888888888741095749e-03;
+const double C3 = 2.48015872894767294178e-05;
+const double C4 = -2.75573143513906633035e-07;
+const double C5 = 2.08757232129817482790e-09;
+const double C6 = -1.13596475577881948265e-11;
+
+const double S1 = -1.66666666666666324348e-01;
+const double S2 = 8.33333333332248946124e-03;
+const double S3 = -1.98412698298579493134e-04;
+const double S4 = 2.75573137070700676789e-06;
+const double S5 = -2.50507602534068634195e-08;
+const double S6 = 1.58969099521155010221e-10;
+
+const double PI = 3.14159265358979311600e+00;
+const double PIO2_HI = 1.57079632679489655800e+00;
+const double PIO2_LO = 6.12323399573676603587e-17;
+const double PS0 = 1.66666666666666657415e-01;
+const double PS1 = -3.25565818622400915405e-01;
+const double PS2 = 2.01212532134862925881e-01;
+const double PS3 = -4.00555345006794114027e-02;
+const double PS4 = 7.91534994289814532176e-04;
+const double PS5 = 3.47933107596021167570e-05;
+const double QS1 = -2.40339491173441421878e+00;
+const double QS2 = 2.02094576023350569471e+00;
+const double QS3 = -6.88283971605453293030e-01;
+const double QS4 = 7.70381505559019352791e-02;
+
+// cos(y) при y >= 0: y = n * pi/2 + r, |r| <= pi/4, по n mod 4 берётся
+// cos(r), -sin(r), -cos(r) или sin(r)
+NO_FP_CONTRACT
+double Cos(double y) {
+    const double n = std::nearbyint(y * TWO_OVER_PI);
+    const double r = (y - n * PIO2_1) - n * PIO2_1T;
+    const double quadrant = n - 4.0 * std::floor(n * 0.25);
+    const double z = r * r;
+
+    const double c = z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+    const double cos_r = 1.0 - (0.5 * z - z * c);
+    const double s = S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)));
+    const double sin_r = r + z * r * (S1 + z * s);
+
+    const double value = (quadrant == 0.0 || quadrant == 2.0) ? cos_r : sin_r;
+    return (quadrant == 1.0 || quadrant == 2.0) ? -value : value;
+}
+
+// acos(x): при |x| < 0.5 - pi/2 - asin(x), иначе через asin(sqrt((1 - |x|) / 2)).
+// Старшая половина df корня s при x > 0.5 возводится в квадрат точно, поправка c
+// возвращает отброшенную часть
+NO_FP_CONTRACT
+double Acos(double x) {
+    const double ax = std::abs(x);
+    const double z = ax < 0.5 ? x * x : (1.0 - ax) * 0.5;
+    const double p = z * (PS0 + z * (PS1 + z * (PS2 + z * (PS3 + z * (PS4 + z * PS5)))));
+    const double q = 1.0 + z * (QS1 + z * (QS2 + z * (QS3 + z * QS4)));
+    const double r = p / q;
+    const double s = std::sqrt(z);
+
+    uint64_t bits;
+    std::memcpy(&bits, &s, sizeof(bits));
+    bits &= 0xFFFFFFFF00000000ull;
+    double df;
+    std::memcpy(&df, &bits, sizeof(df));
+    const double c = (z - df * df) / (s + df);
+
+    if (ax < 0.5) {
+        return PIO2_HI - (x - (PIO2_LO - x * r));
+    }
+    if (x < 0.0) {
+        return PI - 2.0 * (s + (r * s - PIO2_LO));
+    }
+    return x == 1.0 ? 0.0 : 2.0 * (df + (r * s + c));
+}
+
+NO_FP_CONTRACT
+void ComputeDistancesScalar(const double* sin_lat, const double* cos_lat, const double* lng,
+                            const uint32_t* from, const uint32_t* to, double* result, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t a = from[i];
+        const uint32_t b = to[i];
+        const double cos_lng = Cos(std::abs(lng[a] - lng[b]) * DR);
+        result[i] = Acos(sin_lat[a] * sin_lat[b] + cos_lat[a] * cos_lat[b] * cos_lng) * EARTH_RADIUS;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+__m256d Select(__m256d mask, __m256d if_true, __m256d if_false) {
+    return _mm256_blendv_pd(if_false, if_true, mask);
+}
+
+__attribute__((target("avx2"))) NO_FP_CONTRACT
+__m256d CosAvx2(__m256d y) {
+    const __m256d n = _mm256_round_pd(_mm256_mul_pd(y, _mm256_set1_pd(TWO_OVER_PI)),
+                                      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    const __m256d r = _mm256_sub_pd(_mm256_sub_pd(y, _mm256_mul_pd(n, _mm256_set1_pd(PIO2_1))),
+                                    _mm256_mul_pd(n, _mm256_set1_pd(PIO2_1T)));
+    const __m256d quadrant = _mm256_sub_pd(n, _mm256_mul_pd(_mm256_set1_pd(4.0),
+        _mm256_floor_pd(_mm256_mul_pd(n, _mm256_set1_pd(0.25)))));
+    const __m256d z = _mm256_mul_pd(r, r);
+
+    __m256d c = _mm256_add_pd(_mm256_set1_pd(C5), _mm256_mul_pd(z, _mm256_set1_pd(C6)));
+    c = _mm256_add_pd(_mm256_set1_pd(C4), _mm256_mul_pd(z, c));
+    c = _mm256_add_pd(_mm256_set1_pd(C3), _mm256_mul_pd(z, c));
+    c = _mm256_add_pd(_mm256_set1_pd(C2), _mm256_mul_pd(z, c));
+    c = _mm256_mul_pd(z, _mm256_add_pd(_mm256_set1_pd(C1), _mm256_mul_pd(z, c)));
+    const __m256d cos_r = _mm256_sub_pd(_mm256_set1_pd(1.0),
+        _mm256_sub_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), z), _mm256_mul_pd(z, c)));
+
+    __m256d s = _mm256_add_pd(_mm256_set1_pd(S5), _mm256_mul_pd(z, _mm256_set1_pd(S6)));
+    s = _mm256_add_pd(_mm256_set1_pd(S4), _mm256_mul_pd(z, s));
+    s = _mm256_add_pd(_mm256_set1_pd(S3), _mm256_mul_pd(z, s));
+    s = _mm256_add_pd(_mm256_set1_pd(S2), _mm256_mul_pd(z, s));
+    const __m256d sin_r = _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(z, r),
+        _mm256_add_pd(_mm256_set1_pd(S1), _mm256_mul_pd(z, s))));
+
+    const __m256d is_0 = _mm256_cmp_pd(quadrant, _mm256_set1_pd(0.0), _CMP_EQ_OQ);
+    const __m256d is_1 = _mm256_cmp_pd(quadrant, _mm256_set1_pd(1.0), _CMP_EQ_OQ);
+    const __m256d is_2 = _mm256_cmp_pd(quadrant, _mm256_set1_pd(2.0), _CMP_EQ_OQ);
+    const __m256d value = Select(_mm256_or_pd(is_0, is_2), cos_r, sin_r);
+    const __m256d negate = _mm256_and_pd(_mm256_or_pd(is_1, is_2), _mm256_set1_pd(-0.0));
+    return _mm256_xor_pd(value, negate);
+}
+
+__attribute__((target("avx2"))) NO_FP_CONTRACT
+__m256d AcosAvx2(__m256d x) {
+    const __m256d ax = _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+    const __m256d is_small = _mm256_cmp_pd(ax, _mm256_set1_pd(0.5), _CMP_LT_OQ);
+    const __m256d z = Select(is_small, _mm256_mul_pd(x, x),
+                             _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), ax), _mm256_set1_pd(0.5)));
+
+    __m256d p = _mm256_add_pd(_mm256_set1_pd(PS4), _mm256_mul_pd(z, _mm256_set1_pd(PS5)));
+    p = _mm256_add_pd(_mm256_set1_pd(PS3), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(PS2), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(PS1), _mm256_mul_pd(z, p));
+    p = _mm256_mul_pd(z, _mm256_add_pd(_mm256_set1_pd(PS0), _mm256_mul_pd(z, p)));
+    __m256d q = _mm256_add_pd(_mm256_set1_pd(QS3), _mm256_mul_pd(z, _mm256_set1_pd(QS4)));
+    q = _mm256_add_pd(_mm256_set1_pd(QS2), _mm256_mul_pd(z, q));
+    q = _mm256_add_pd(_mm256_set1_pd(QS1), _mm256_mul_pd(z, q));
+    q = _mm256_add_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(z, q));
+    const __m256d r = _mm256_div_pd(p, q);
+    const __m256d s = _mm256_sqrt_pd(z);
+
+    const __m256d df = _mm256_and_pd(s, _mm256_castsi256_pd(_mm256_set1_epi64x(
+        static_cast<long long>(0xFFFFFFFF00000000ull))));
+    const __m256d c = _mm256_div_pd(_mm256_sub_pd(z, _mm256_mul_pd(df, df)), _mm256_add_pd(s, df));
+
+    const __m256d small = _mm256_sub_pd(_mm256_set1_pd(PIO2_HI),
+        _mm256_sub_pd(x, _mm256_sub_pd(_mm256_set1_pd(PIO2_LO), _mm256_mul_pd(x, r))));
+    const __m256d negative = _mm256_sub_pd(_mm256_set1_pd(PI), _mm256_mul_pd(_mm256_set1_pd(2.0),
+        _mm256_add_pd(s, _mm256_sub_pd(_mm256_mul_pd(r, s), _mm256_set1_pd(PIO2_LO)))));
+    const __m256d positive = _mm256_mul_pd(_mm256_set1_pd(2.0),
+        _mm256_add_pd(df, _mm256_add_pd(_mm256_mul_pd(r, s), c)));
+
+    const __m256d is_one = _mm256_cmp_pd(x, _mm256_set1_pd(1.0), _CMP_EQ_OQ);
+    const __m256d is_negative = _mm256_cmp_pd(x, _mm256_set1_pd(0.0), _CMP_LT_OQ);
+    const __m256d large = Select(is_negative, negative, Select(is_one, _mm256_setzero_pd(), positive));
+    return Select(is_small, small, large);
+}
+
+// Форма с явными исходным значением и маской: у _mm256_i32gather_pd GCC 12
+// ошибочно предупреждает о неинициализированном регистре
+__attribute__((target("avx2")))
+__m256d Gather(const double* base, __m128i index) {
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, index, all, 8);
+}
+
+__attribute__((target("avx2"))) NO_FP_CONTRACT
+void ComputeDistancesAvx2(const double* sin_lat, const double* cos_lat, const double* lng,
+                          const uint32_t* from, const uint32_t* to, double* result, size_t count) {
+    const __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(to + i));
+        const __m256d lng_diff = _mm256_and_pd(abs_mask,
+            _mm256_sub_pd(Gather(lng, a), Gather(lng, b)));
+        const __m256d cos_lng = CosAvx2(_mm256_mul_pd(lng_diff, _mm256_set1_pd(DR)));
+        const __m256d sin_product = _mm256_mul_pd(Gather(sin_lat, a),
+                                                  Gather(sin_lat, b));
+        const __m256d cos_product = _mm256_mul_pd(Gather(cos_lat, a),
+                                                  Gather(cos_lat, b));
+        const __m256d angle = AcosAvx2(_mm256_add_pd(sin_product, _mm256_mul_pd(cos_product, cos_lng)));
+        _mm256_storeu_pd(result + i, _mm256_mul_pd(angle, _mm256_set1_pd(EARTH_RADIUS)));
+    }
+    ComputeDistancesScalar(sin_lat, cos_lat, lng, from + i, to + i, result + i, count - i);
+}
+#endif
+
+using DistancesKernel = void (*)(const double*, const double*, const double*,
+                                 const uint32_t*, const uint32_t*, double*, size_t);
+
+// Самый быстрый вариант, который поддерживает процессор, выбирается один раз
+DistancesKernel ChooseDistancesKernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) {
+        return ComputeDistancesAvx2;
+    }
+#endif
+    return ComputeDistancesScalar;
+}
+
+}  // namespace
+
+void ComputeDistances(const double* sin_lat, const double* cos_lat, const double* lng,
+                      const uint32_t* from, const uint32_t* to, double* result, size_t count) {
+    static const DistancesKernel kernel = ChooseDistancesKernel();
+    kernel(sin_lat, cos_lat, lng, from, to, result, count);
+}
+
+}  // namespace geo
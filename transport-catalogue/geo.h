@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 namespace geo {
 
     struct Coordinates {
@@ -9,4 +12,16 @@ namespace geo {
 
     double ComputeDistance(Coordinates from, Coordinates to);
 
-}  // namespace geo
\ No newline at end of file
+    // Синус и косинус широты в градусах - для заранее подготовленных точек
+    double SinLatitude(double lat);
+    double CosLatitude(double lat);
+
+    // Пакетный вариант ComputeDistance: result[i] - расстояние между точками from[i] и to[i].
+    // Точки заданы столбцами sin_lat, cos_lat (см. SinLatitude/CosLatitude) и lng в градусах.
+    // cos и acos считаются собственными многочленами: на AVX2 по четыре пары, иначе по одной,
+    // с одинаковым результатом. Относительная разница с ComputeDistance на расстояниях
+    // от 10 м не больше 1e-10, на городских обычно нулевая (tests/geo_test.cpp)
+    void ComputeDistances(const double* sin_lat, const double* cos_lat, const double* lng,
+                          const uint32_t* from, const uint32_t* to, double* result, size_t count);
+
+}  // namespace geo
@@ -1,5 +1,20 @@
 #include "json.h"
-#include <iomanip>
+#include "json_number.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+
+#include <sys/uio.h>
+
+#if defined(__SSE2__) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -8,169 +23,399 @@ namespace json {
 //----------- Load ----------
 namespace load{
 
-std::string ClearLine (const std::string& str) {
-    size_t start = 0, end = str.length();
-
-    while (start < str.length() && 
-        (str[start] == '\n' || 
-        str[start] == '\r' || 
-        str[start] == '\t' || 
-        str[start] == ' ')) {
-        start++;
-    }
-    while (end > 0 && 
-        (str[end - 1] == '\n' || 
-        str[end - 1] == '\r' || 
-        str[end - 1] == '\t' || 
-        str[end - 1] == ' ')) {
-        end--;
-    }
-    return str.substr(start, end - start);
-}    
-
-std::string FindEndOfLine (istream& input) {
-    std::string result;
-    char ch;
-    while (input.get(ch)) {
-        if (ch == '}' || ch == ',' || ch == ']') {
-            input.putback(ch);
+// Разбор в два этапа. Этап 1 (StructuralIndex) блоками по 64 символа находит
+// кавычки, обратные косые черты и структурные символы и строит индекс: позиции
+// структурных символов вне строк, всех неэкранированных кавычек и начал
+// скаляров (чисел и литералов). Этап 2 (Parser) переходит по индексу от позиции
+// к позиции, не просматривая пробелы и содержимое строк, и сообщает о найденных
+// значениях обработчику событий: TreeBuilder строит из них дерево для Load.
+// Индекс строится порциями по мере разбора, так что его память не зависит от размера текста
+
+// Маски одного блока: бит i соответствует символу i блока
+struct BlockMasks {
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t op = 0;            // { } [ ] : ,
+    uint64_t whitespace = 0;
+    uint64_t newline = 0;       // \n и \r, недопустимые внутри строк
+};
+
+constexpr size_t BLOCK_SIZE = 64;
+
+BlockMasks ClassifyScalar(const char* block) {
+    BlockMasks masks;
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        const uint64_t bit = uint64_t{1} << i;
+        switch (block[i]) {
+        case '"':
+            masks.quote |= bit;
+            break;
+        case '\\':
+            masks.backslash |= bit;
+            break;
+        case '{': case '}': case '[': case ']': case ':': case ',':
+            masks.op |= bit;
+            break;
+        case '\n': case '\r':
+            masks.newline |= bit;
+            masks.whitespace |= bit;
+            break;
+        case ' ': case '\t':
+            masks.whitespace |= bit;
+            break;
+        default:
             break;
         }
-        result += ch;
     }
-    return result;
+    return masks;
 }
 
-json::Node Node(istream& input);
+#if defined(__SSE2__)
+uint64_t MatchSse2(__m128i bytes, char c) {
+    return static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c))));
+}
 
-json::Node Null(istream& input){
-    std::string line;
-    line = FindEndOfLine(input);
-    line = ClearLine(line);
-    if (line != "null") {
-        throw ParsingError("Error while parsing JSON, wrong argument - null");
+// '[' и '{', ']' и '}' отличаются только битом 0x20, поэтому скобки
+// находятся двумя сравнениями после c | 0x20
+BlockMasks ClassifySse2(const char* block) {
+    BlockMasks masks;
+    for (size_t i = 0; i < BLOCK_SIZE; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        const __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        const uint64_t newline = MatchSse2(chunk, '\n') | MatchSse2(chunk, '\r');
+        masks.quote |= MatchSse2(chunk, '"') << i;
+        masks.backslash |= MatchSse2(chunk, '\\') << i;
+        masks.newline |= newline << i;
+        masks.whitespace |= (newline | MatchSse2(chunk, ' ') | MatchSse2(chunk, '\t')) << i;
+        masks.op |= (MatchSse2(lower, '{') | MatchSse2(lower, '}')
+                     | MatchSse2(chunk, ':') | MatchSse2(chunk, ',')) << i;
     }
-    return json::Node();
+    return masks;
 }
+#endif
 
-json::Node Array(istream& input) {
-    json::Array result;
-    if (input.peek() == -1) {
-        throw ParsingError("Unexpected end of input");
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+uint64_t MatchAvx2(__m256i bytes, char c) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c))));
+}
+
+__attribute__((target("avx2")))
+BlockMasks ClassifyAvx2(const char* block) {
+    BlockMasks masks;
+    for (size_t i = 0; i < BLOCK_SIZE; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+        const __m256i lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+        const uint64_t newline = MatchAvx2(chunk, '\n') | MatchAvx2(chunk, '\r');
+        masks.quote |= MatchAvx2(chunk, '"') << i;
+        masks.backslash |= MatchAvx2(chunk, '\\') << i;
+        masks.newline |= newline << i;
+        masks.whitespace |= (newline | MatchAvx2(chunk, ' ') | MatchAvx2(chunk, '\t')) << i;
+        masks.op |= (MatchAvx2(lower, '{') | MatchAvx2(lower, '}')
+                     | MatchAvx2(chunk, ':') | MatchAvx2(chunk, ',')) << i;
     }
-    for (char c; input >> c && c != ']';) {
-        if (c != ',') {
-            input.putback(c);
-        }
-        result.push_back(load::Node(input));
+    return masks;
+}
+#endif
+
+using Classifier = BlockMasks (*)(const char*);
+
+// Самый быстрый вариант, который поддерживает процессор, выбирается один раз
+Classifier ChooseClassifier() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) {
+        return ClassifyAvx2;
     }
-    return json::Node(move(result));
+#endif
+#if defined(__SSE2__)
+    return ClassifySse2;
+#else
+    return ClassifyScalar;
+#endif
 }
 
-using Number = std::variant<int, double>;
+// Бит i результата - xor битов 0..i: единицы от открывающей кавычки до закрывающей
+uint64_t PrefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
 
-Number LoadNumber(std::istream& input) {
-    using namespace std::literals;
+int CountTrailingZeros(uint64_t bits) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int count = 0;
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
 
-    std::string parsed_num;
+class StructuralIndex {
+public:
+    StructuralIndex(const char* begin, const char* end)
+        : block_(begin)
+        , end_(end)
+        , classify_(ChooseClassifier()) {
+    }
 
-    // Считывает в parsed_num очередной символ из input
-    auto read_char = [&parsed_num, &input] {
-        parsed_num += static_cast<char>(input.get());
-        if (!input) {
-            throw ParsingError("Failed to read number from stream"s);
+    // Следующая позиция индекса или конец текста, если позиций больше нет
+    const char* Next() {
+        while (next_ == size_) {
+            if (block_ >= end_) {
+                return end_;
+            }
+            ScanBatch();
         }
-    };
+        return positions_[next_++];
+    }
 
-    // Считывает одну или более цифр в parsed_num из input
-    auto read_digits = [&input, read_char] {
-        if (!std::isdigit(input.peek())) {
-            throw ParsingError("A digit is expected"s);
+private:
+    static constexpr size_t BATCH_BLOCKS = 64;
+
+    const char* block_;
+    const char* end_;
+    Classifier classify_;
+    // Позиции текущей порции: в блоке их не больше BLOCK_SIZE, поэтому
+    // массив выделяется один раз и заполняется без проверок ёмкости
+    std::vector<const char*> positions_ = std::vector<const char*>(BATCH_BLOCKS * BLOCK_SIZE);
+    size_t size_ = 0;
+    size_t next_ = 0;
+
+    // Переносы между блоками
+    uint64_t prev_in_string_ = 0;   // все единицы, если блок закончился внутри строки
+    uint64_t prev_escaped_ = 0;     // 1, если первый символ блока экранирован
+    uint64_t prev_scalar_ = 0;      // 1, если блок закончился внутри скаляра
+
+    void ScanBatch() {
+        size_ = 0;
+        next_ = 0;
+        for (size_t i = 0; i < BATCH_BLOCKS && block_ < end_; ++i, block_ += BLOCK_SIZE) {
+            if (static_cast<size_t>(end_ - block_) >= BLOCK_SIZE) {
+                ScanBlock(block_);
+            } else {
+                // Неполный последний блок дополняется пробелами
+                char padded[BLOCK_SIZE];
+                std::memset(padded, ' ', BLOCK_SIZE);
+                std::memcpy(padded, block_, static_cast<size_t>(end_ - block_));
+                ScanBlock(padded);
+            }
         }
-        while (std::isdigit(input.peek())) {
-            read_char();
+    }
+
+    void ScanBlock(const char* data) {
+        const BlockMasks masks = classify_(data);
+
+        // Экранированные символы. Обратная косая черта встречается редко,
+        // поэтому такие блоки разбираются побитно
+        uint64_t escaped = 0;
+        if (masks.backslash != 0 || prev_escaped_ != 0) {
+            uint64_t carry = prev_escaped_;
+            for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+                const uint64_t bit = uint64_t{1} << i;
+                if (carry != 0) {
+                    escaped |= bit;
+                    carry = 0;
+                } else if ((masks.backslash & bit) != 0) {
+                    carry = 1;
+                }
+            }
+            prev_escaped_ = carry;
         }
-    };
 
-    if (input.peek() == '-') {
-        read_char();
+        const uint64_t quote = masks.quote & ~escaped;
+        const uint64_t in_string = PrefixXor(quote) ^ prev_in_string_;
+        prev_in_string_ = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+        if ((masks.newline & in_string) != 0) {
+            // Строковый литерал внутри JSON не может прерываться символами \r или \n
+            throw ParsingError("Unexpected end of line"s);
+        }
+
+        const uint64_t structural = masks.op & ~in_string;
+        const uint64_t scalar = ~(masks.op | masks.whitespace | quote | in_string);
+        const uint64_t scalar_starts = scalar & ~((scalar << 1) | prev_scalar_);
+        prev_scalar_ = scalar >> 63;
+
+        const char* base = block_;
+        const char** out = positions_.data() + size_;
+        for (uint64_t bits = structural | quote | scalar_starts; bits != 0; bits &= bits - 1) {
+            *out++ = base + CountTrailingZeros(bits);
+        }
+        size_ = static_cast<size_t>(out - positions_.data());
     }
-    // Парсим целую часть числа
-    if (input.peek() == '0') {
-        read_char();
-        // После 0 в JSON не могут идти другие цифры
-    } else {
-        read_digits();
+};
+
+// Этап 2: дерево по индексу. Позиции индекса, которые получает Parse*, уже проверены
+// на соответствие ожидаемому символу
+// Handler - EventHandler или его final-наследник: для последнего вызовы
+// обработчика не виртуальные
+template <typename Handler>
+class Parser {
+public:
+    Parser(const char* begin, const char* end, Handler& handler)
+        : end_(end)
+        , index_(begin, end)
+        , handler_(handler) {
+    }
+
+    void ParseDocument() {
+        ParseValue(NextToken());
     }
 
-    bool is_int = true;
-    // Парсим дробную часть числа
-    if (input.peek() == '.') {
-        read_char();
-        read_digits();
-        is_int = false;
+    // Элементы массива без скобок: хотя бы один, через запятую
+    void ParseItems() {
+        ParseValue(NextToken());
+        for (const char* token = index_.Next(); token != end_; token = index_.Next()) {
+            if (*token != ',') {
+                throw ParsingError("Expected ',' or ']' in array");
+            }
+            ParseValue(NextToken());
+        }
     }
 
-    // Парсим экспоненциальную часть числа
-    if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-        read_char();
-        if (ch = input.peek(); ch == '+' || ch == '-') {
-            read_char();
+private:
+    const char* end_;
+    StructuralIndex index_;
+    Handler& handler_;
+    std::string unescaped_;     // строка с escape-последовательностями после раскодирования
+
+    const char* NextToken() {
+        const char* token = index_.Next();
+        if (token == end_) {
+            throw ParsingError("Unexpected end of input");
         }
-        read_digits();
-        is_int = false;
+        return token;
     }
 
-    try {
-        if (is_int) {
-            // Сначала пробуем преобразовать строку в int
-            try {
-                return std::stoi(parsed_num);
-            } catch (...) {
-                // В случае неудачи, например, при переполнении,
-                // код ниже попробует преобразовать строку в double
+    static bool IsDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    // Скаляр должен заканчиваться разделителем: "nullx" и "12a" - ошибки
+    bool IsScalarEnd(const char* pos) const {
+        return pos == end_ || *pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t'
+            || *pos == ',' || *pos == ']' || *pos == '}' || *pos == ':' || *pos == '"'
+            || *pos == '[' || *pos == '{';
+    }
+
+    void ParseValue(const char* token) {
+        switch (*token) {
+        case 'n':
+            ParseLiteral(token, "null"sv);
+            handler_.Null();
+            return;
+        case 't':
+            ParseLiteral(token, "true"sv);
+            handler_.Bool(true);
+            return;
+        case 'f':
+            ParseLiteral(token, "false"sv);
+            handler_.Bool(false);
+            return;
+        case '[':
+            ParseArray();
+            return;
+        case '{':
+            ParseDict();
+            return;
+        case '"':
+            handler_.String(ParseString(token));
+            return;
+        default:
+            if (IsDigit(*token) || *token == '-') {
+                ParseNumber(token);
+                return;
             }
+            throw ParsingError("Error while parsing JSON, wrong argument - node '"s + *token + "'"s);
         }
-        return std::stod(parsed_num);
-    } catch (...) {
-        throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
     }
-}
 
-json::Node Num(istream& input) {
-    Number parsed = LoadNumber(input);
-    
-    if (std::holds_alternative<int>(parsed)){
-            return json::Node(get<int>(parsed));
+    void ParseLiteral(const char* pos, std::string_view literal) const {
+        if (static_cast<size_t>(end_ - pos) < literal.size()
+            || std::string_view(pos, literal.size()) != literal
+            || !IsScalarEnd(pos + literal.size())) {
+            throw ParsingError("Error while parsing JSON, wrong argument - "s + std::string(literal));
+        }
     }
-    return json::Node(get<double>(parsed));
-}
 
-std::string LoadString(std::istream& input) {
-    using namespace std::literals;
-    
-    auto it = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
-    std::string s;
-    while (true) {
-        if (it == end) {
-            // Поток закончился до того, как встретили закрывающую кавычку?
+    void ParseArray() {
+        handler_.StartArray();
+        const char* token = NextToken();
+        if (*token == ']') {
+            handler_.EndArray();
+            return;
+        }
+        while (true) {
+            ParseValue(token);
+            token = NextToken();
+            if (*token == ']') {
+                break;
+            }
+            if (*token != ',') {
+                throw ParsingError("Expected ',' or ']' in array");
+            }
+            token = NextToken();
+        }
+        handler_.EndArray();
+    }
+
+    void ParseDict() {
+        handler_.StartObject();
+        const char* token = NextToken();
+        if (*token == '}') {
+            handler_.EndObject();
+            return;
+        }
+        while (true) {
+            if (*token != '"') {
+                throw ParsingError("Expected string key in dict");
+            }
+            handler_.Key(ParseString(token));
+            if (*NextToken() != ':') {
+                throw ParsingError("Expected ':' after dict key");
+            }
+            ParseValue(NextToken());
+            token = NextToken();
+            if (*token == '}') {
+                break;
+            }
+            if (*token != ',') {
+                throw ParsingError("Expected ',' or '}' in dict");
+            }
+            token = NextToken();
+        }
+        handler_.EndObject();
+    }
+
+    // Следующая позиция индекса после открывающей кавычки - закрывающая кавычка.
+    // Строка без escape-последовательностей возвращается как часть текста,
+    // иначе - как unescaped_, действительная до следующего вызова
+    std::string_view ParseString(const char* open) {
+        const char* close = index_.Next();
+        if (close == end_) {
             throw ParsingError("String parsing error");
         }
-        const char ch = *it;
-        if (ch == '"') {
-            // Встретили закрывающую кавычку
-            ++it;
-            break;
-        } else if (ch == '\\') {
-            // Встретили начало escape-последовательности
-            ++it;
-            if (it == end) {
-                // Поток завершился сразу после символа обратной косой черты
-                throw ParsingError("String parsing error");
+        const char* begin = open + 1;
+        const char* escape = static_cast<const char*>(std::memchr(begin, '\\', static_cast<size_t>(close - begin)));
+        if (escape == nullptr) {
+            return std::string_view(begin, static_cast<size_t>(close - begin));
+        }
+        std::string& s = unescaped_;
+        s.assign(begin, escape);
+        for (const char* pos = escape; pos != close; ++pos) {
+            if (*pos != '\\') {
+                s.push_back(*pos);
+                continue;
             }
-            const char escaped_char = *(it);
             // Обрабатываем одну из последовательностей: \\, \n, \t, \r, \"
+            const char escaped_char = *++pos;
             switch (escaped_char) {
                 case 'n':
                     s.push_back('\n');
@@ -188,203 +433,411 @@ std::string LoadString(std::istream& input) {
                     s.push_back('\\');
                     break;
                 default:
-                    // Встретили неизвестную escape-последовательность
                     throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
             }
-        } else if (ch == '\n' || ch == '\r') {
-            // Строковый литерал внутри- JSON не может прерываться символами \r или \n
-            throw ParsingError("Unexpected end of line"s);
+        }
+        return s;
+    }
+
+    const char* SkipDigits(const char* pos) const {
+        if (pos == end_ || !IsDigit(*pos)) {
+            throw ParsingError("A digit is expected"s);
+        }
+        while (pos != end_ && IsDigit(*pos)) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    void ParseNumber(const char* begin) {
+        const char* pos = begin;
+        if (*pos == '-') {
+            ++pos;
+        }
+        // После 0 в JSON не могут идти другие цифры
+        if (pos != end_ && *pos == '0') {
+            ++pos;
         } else {
-            // Просто считываем очередной символ и помещаем его в результирующую строку
-            s.push_back(ch);
+            pos = SkipDigits(pos);
         }
-        ++it;
+        bool is_int = true;
+        if (pos != end_ && *pos == '.') {
+            pos = SkipDigits(pos + 1);
+            is_int = false;
+        }
+        if (pos != end_ && (*pos == 'e' || *pos == 'E')) {
+            ++pos;
+            if (pos != end_ && (*pos == '+' || *pos == '-')) {
+                ++pos;
+            }
+            pos = SkipDigits(pos);
+            is_int = false;
+        }
+        if (!IsScalarEnd(pos)) {
+            throw ParsingError("Failed to read number"s);
+        }
+
+        if (is_int) {
+            // Целое, не помещающееся в int, читается как double
+            if (const std::optional<int> value = number::ParseInt(begin, pos)) {
+                handler_.Int(*value);
+                return;
+            }
+        }
+        const double value = number::ParseDouble(begin, pos);
+        handler_.Double(value);
     }
+};
 
-    return s;
-}
+}  // load
 
-json::Node String(istream& input) {
-    return json::Node(move(LoadString(input)));
+//----------- Sink ----------
+
+Sink::Sink(size_t capacity)
+    : buffer_(std::make_unique<char[]>(capacity))
+    , capacity_(capacity) {
 }
 
-json::Node Bool(istream& input){
-    std::string line;
-    line = FindEndOfLine(input);
-    line = ClearLine(line);
-    if (line != "true" && line != "false") {
-        throw ParsingError("Error while parsing JSON, wrong argument - bool");
-    } else if (line == "false"){
-        return json::Node(false);
+void Sink::Flush() {
+    if (used_ > 0) {
+        const size_t used = used_;
+        used_ = 0;
+        Send(std::string_view(buffer_.get(), used), {});
     }
-    return json::Node(true);
 }
 
-json::Node Dict(istream& input) {
-    json::Dict result;
-    if (input.peek() == -1) {
-        throw ParsingError("Unexpected end of input");
+void Sink::FlushNoThrow() noexcept {
+    try {
+        Flush();
+    } catch (...) {
     }
-    for (char c; input >> c && c != '}';) {
-        if (c == ',') {
-            input >> c;
-        }
+}
 
-        string key = load::String(input).AsString();
-        input >> c;
-        result.insert({move(key), load::Node(input)});
+void Sink::Overflow(const char* data, size_t size) {
+    if (size < capacity_) {
+        Flush();
+        std::memcpy(buffer_.get(), data, size);
+        used_ = size;
+        return;
     }
+    const size_t used = used_;
+    used_ = 0;
+    Send(std::string_view(buffer_.get(), used), std::string_view(data, size));
+}
 
-    return json::Node(move(result));
+StreamSink::StreamSink(std::ostream& output, size_t capacity)
+    : Sink(capacity)
+    , output_(output) {
 }
 
-json::Node Node(istream& input) {
-    char c;
-    while (input && 
-        (c == '\n' || 
-        c == '\r' || 
-        c == '\t' || 
-        c == ' ')) {
-        input >> c;
-    }
-    input >> c;
-    switch (c)
-    {
-    case 'n':
-        input.putback(c);
-        return load::Null(input);
-        break;
-    case 't':
-        input.putback(c);
-        return load::Bool(input);
-        break;
-    case 'f':
-        input.putback(c);
-        return load::Bool(input);
-        break;
-    case '[':
-        return load::Array(input);
-        break;
-    case '{':
-        return load::Dict(input);
-        break;
-    case '"':
-        return load::String(input);
-        break;
-    default:
-        if (isdigit(c) || c == '-') {
-            input.putback(c);
-            return load::Num(input);
+StreamSink::~StreamSink() {
+    FlushNoThrow();
+}
+
+void StreamSink::Send(std::string_view buffered, std::string_view data) {
+    output_.write(buffered.data(), static_cast<std::streamsize>(buffered.size()));
+    output_.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+StringSink::StringSink(std::string& output, size_t capacity)
+    : Sink(capacity)
+    , output_(output) {
+}
+
+StringSink::~StringSink() {
+    FlushNoThrow();
+}
+
+void StringSink::Send(std::string_view buffered, std::string_view data) {
+    output_.reserve(output_.size() + buffered.size() + data.size());
+    output_.append(buffered);
+    output_.append(data);
+}
+
+FdSink::FdSink(int fd, size_t capacity)
+    : Sink(capacity)
+    , fd_(fd) {
+}
+
+FdSink::~FdSink() {
+    FlushNoThrow();
+}
+
+// writev может записать только часть: остаток дописывается, пока не кончится
+void FdSink::Send(std::string_view buffered, std::string_view data) {
+    iovec parts[2] = {
+        {const_cast<char*>(buffered.data()), buffered.size()},
+        {const_cast<char*>(data.data()), data.size()}
+    };
+    iovec* part = parts;
+    iovec* const end = parts + 2;
+    while (part != end) {
+        if (part->iov_len == 0) {
+            ++part;
+            continue;
+        }
+        const ssize_t written = ::writev(fd_, part, static_cast<int>(end - part));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "Failed to write JSON output");
         }
-        else {
-            std::cerr << "Unexpected input : '"<< c << "'"<< std::endl;
-            throw ParsingError("Error while parsing JSON, wrong argument - node");
+        for (size_t rest = static_cast<size_t>(written); rest > 0;) {
+            const size_t skip = std::min(rest, part->iov_len);
+            part->iov_base = static_cast<char*>(part->iov_base) + skip;
+            part->iov_len -= skip;
+            rest -= skip;
+            if (part->iov_len == 0) {
+                ++part;
+            }
         }
-        break;
     }
 }
 
-}  // load
+//----------- Writer ----------
 
-//----------- Print ----------
 namespace print {
 
-    void Node (const json::Node& node, std::ostream& out, size_t tabulation);
+// Первый символ из [pos, end), который нужно экранировать, или end. SSE2 проверяет по 16 символов
+// за раз: строки ответов - имена и карта - почти не содержат таких символов
+const char* FindEscaped(const char* pos, const char* end) {
+#if defined(__SSE2__)
+    for (; end - pos >= 16; pos += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        const uint64_t bits = load::MatchSse2(chunk, '"') | load::MatchSse2(chunk, '\\')
+                              | load::MatchSse2(chunk, '\n') | load::MatchSse2(chunk, '\r')
+                              | load::MatchSse2(chunk, '\t');
+        if (bits != 0) {
+            return pos + load::CountTrailingZeros(bits);
+        }
+    }
+#endif
+    for (; pos != end; ++pos) {
+        switch (*pos) {
+        case '"': case '\\': case '\n': case '\r': case '\t':
+            return pos;
+        default:
+            break;
+        }
+    }
+    return end;
+}
+
+const char* EscapeSequence(char c) {
+    switch (c) {
+    case '\\':
+        return "\\\\";
+    case '\n':
+        return "\\n";
+    case '\r':
+        return "\\r";
+    case '"':
+        return "\\\"";
+    default:
+        return "\\t";
+    }
+}
+
+}  // print
+
+Writer::Writer(Sink& output, size_t depth, PrintOptions options)
+    : output_(&output)
+    , depth_(depth)
+    , options_(options) {
+}
+
+Writer::Writer(std::ostream& output, size_t depth, PrintOptions options)
+    : own_output_(std::make_unique<StreamSink>(output))
+    , output_(own_output_.get())
+    , depth_(depth)
+    , options_(options) {
+}
 
-    // Шаблон, подходящий для вывода double и int
-    template <typename T>
-    void Value(const T& value, std::ostream& out, [[maybe_unused]] size_t tabulation) {
-        out << value;
+Writer& Writer::StartDict() {
+    BeforeValue();
+    output_->Put('{');
+    levels_.push_back({true});
+    return *this;
+}
+
+Writer& Writer::EndDict() {
+    if (levels_.empty() || !levels_.back().is_dict || levels_.back().has_key) {
+        throw std::logic_error("EndDict() when there is no complete Dict");
+    }
+    const bool empty = levels_.back().empty;
+    levels_.pop_back();
+    // Пустой словарь в PRETTY, как и прежде, занимает три строки
+    if (empty && options_.layout == Layout::PRETTY) {
+        output_->Put('\n');
     }
+    NewLine();
+    output_->Put('}');
+    return *this;
+}
 
-    // Перегрузка функции PrintValue для вывода значений null
-    void Value(std::nullptr_t, std::ostream& out, [[maybe_unused]] size_t tabulation) {
-        out << "null"sv;
+Writer& Writer::StartArray() {
+    BeforeValue();
+    output_->Put('[');
+    levels_.push_back({false});
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    if (levels_.empty() || levels_.back().is_dict) {
+        throw std::logic_error("EndArray() when there is no Array");
+    }
+    const bool empty = levels_.back().empty;
+    levels_.pop_back();
+    if (!empty) {
+        NewLine();
     }
+    output_->Put(']');
+    return *this;
+}
 
-    // Перегрузка функции PrintValue для вывода значений bool
-    void Value(bool value, std::ostream&out, [[maybe_unused]] size_t tabulation) {
-        if (value) {
-            out << "true"sv;
-        } else {
-            out << "false"sv;
-        }
+Writer& Writer::Key(std::string_view key) {
+    if (levels_.empty() || !levels_.back().is_dict || levels_.back().has_key) {
+        throw std::logic_error("Key() when there is no Dict");
+    }
+    Level& level = levels_.back();
+    if (!level.empty) {
+        output_->Put(',');
     }
+    level.empty = false;
+    level.has_key = true;
+    NewLine();
+    WriteString(key);
+    if (options_.layout == Layout::PRETTY) {
+        output_->Write(": ", 2);
+    } else {
+        output_->Put(':');
+    }
+    return *this;
+}
 
-    // Перегрузка функции PrintValue для вывода значений string
-    void Value(const std::string& value, std::ostream& out, [[maybe_unused]] size_t tabulation){
-        out << "\"";
-        for (char c : value){
-            switch (c)
-            {
-            case '\\':
-                out << "\\\\"sv;
-                break;
-            case '\n':
-                out << "\\n"sv;
-                break;
-            case '\r':
-                out << "\\r"sv;
-                break;
-            case '\"':
-                out << "\\\""sv;
-                break;
-            case '\t':
-                out << "\\t"sv;
-                break;
-            default:
-                out << c;
-                break;
-            } 
-        }
-        out << "\"";
+Writer& Writer::Value(std::nullptr_t) {
+    BeforeValue();
+    output_->Write("null", 4);
+    return *this;
+}
+
+Writer& Writer::Value(bool value) {
+    BeforeValue();
+    if (value) {
+        output_->Write("true", 4);
+    } else {
+        output_->Write("false", 5);
     }
+    return *this;
+}
 
-    // Перегрузка функции PrintValue для вывода значений array
-    void Value(const json::Array& array, std::ostream& out, size_t tabulation) {
-        out << '[';
-        if (array.empty()) {
-            out << ']';
-            return;
+Writer& Writer::Value(int value) {
+    BeforeValue();
+    char buffer[number::MAX_LENGTH];
+    output_->Write(buffer, static_cast<size_t>(number::Format(value, buffer) - buffer));
+    return *this;
+}
+
+Writer& Writer::Value(double value) {
+    BeforeValue();
+    char buffer[number::MAX_LENGTH];
+    output_->Write(buffer, static_cast<size_t>(number::Format(value, buffer, options_.format) - buffer));
+    return *this;
+}
+
+Writer& Writer::Value(std::string_view value) {
+    BeforeValue();
+    WriteString(value);
+    return *this;
+}
+
+Writer& Writer::Value(const std::string& value) {
+    return Value(std::string_view(value));
+}
+
+Writer& Writer::Value(const char* value) {
+    return Value(std::string_view(value));
+}
+
+Writer& Writer::Value(const Node& node) {
+    if (node.IsArray()) {
+        StartArray();
+        for (const Node& item : node.AsArray()) {
+            Value(item);
         }
-        out <<  std::endl;
-        tabulation += 4;
-        bool first = true;
-        for (auto& value : array){
-            if (!first) {
-                out << ',' << std::endl;
-            }
-            out << std::string(tabulation,' ');
-            //if (value.IsBool()) out << std::endl;
-            print::Node(value,out,tabulation);
-            first = false;
-        }
-        out << std::endl << std::string(tabulation-4,' ') << ']';
-    }
-
-    // Перегрузка функции PrintValue для вывода значений dict
-    void Value(const json::Dict& dict, std::ostream& out, size_t tabulation) {
-        out << '{' << std::endl;
-        tabulation += 4;
-        bool first = true;
-        for (const auto& [key,value] : dict){
-            if (!first) {
-                out << ',' << std::endl;
-            }
-            out << std::string(tabulation,' ') << '\"' << key << "\": ";
-            print::Node(value,out,tabulation);
-            first = false;
+        return EndArray();
+    }
+    if (node.IsMap()) {
+        StartDict();
+        for (const auto& [key, value] : node.AsMap()) {
+            Key(key).Value(value);
         }
-        out << std::endl << std::string(tabulation-4,' ') << '}';
+        return EndDict();
     }
+    std::visit([this](const auto& value){
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (!std::is_same_v<T, Array> && !std::is_same_v<T, Dict>) {
+            Value(value);
+        }
+    }, node.GetValue());
+    return *this;
+}
 
-    void Node(const json::Node& node, std::ostream& out, size_t tabulation) {
-        std::visit(
-            [&out, tabulation](const auto& value){ print::Value(value, out, tabulation); },
-            node.GetValue());
+Writer& Writer::RawValue(std::string_view json) {
+    BeforeValue();
+    output_->Write(json);
+    return *this;
+}
+
+// Элемент массива начинается с новой строки, значение в словаре идёт после ключа
+void Writer::BeforeValue() {
+    if (levels_.empty()) {
+        return;
+    }
+    Level& level = levels_.back();
+    if (level.is_dict) {
+        if (!level.has_key) {
+            throw std::logic_error("Value() in Dict without Key()");
+        }
+        level.has_key = false;
+        return;
     }
+    if (!level.empty) {
+        output_->Put(',');
+    }
+    level.empty = false;
+    NewLine();
+}
 
-} // print
+void Writer::NewLine() {
+    if (options_.layout == Layout::COMPACT) {
+        return;
+    }
+    static const std::string spaces(64, ' ');
+    output_->Put('\n');
+    for (size_t count = (depth_ + levels_.size()) * 4; count > 0;) {
+        const size_t part = std::min(count, spaces.size());
+        output_->Write(spaces.data(), part);
+        count -= part;
+    }
+}
+
+// Символы без экранирования выводятся отрезками, а не по одному
+void Writer::WriteString(std::string_view str) {
+    output_->Put('"');
+    const char* end = str.data() + str.size();
+    for (const char* run = str.data();;) {
+        const char* pos = print::FindEscaped(run, end);
+        output_->Write(run, static_cast<size_t>(pos - run));
+        if (pos == end) {
+            break;
+        }
+        output_->Write(print::EscapeSequence(*pos), 2);
+        run = pos + 1;
+    }
+    output_->Put('"');
+}
 
 
 //----------- Node ----------
@@ -455,6 +908,48 @@ const Dict& Node::AsMap() const {
     return std::get<Dict>(node_);
 }
 
+//----------- Memory usage ----------
+namespace usage {
+
+    struct Totals {
+        memory::Usage nodes {"json.nodes"};
+        memory::Usage strings {"json.strings"};
+        memory::Usage arrays {"json.arrays"};
+        memory::Usage dicts {"json.dicts"};
+    };
+
+    void String(const std::string& str, Totals& totals) {
+        // Короткие строки libstdc++ хранит внутри объекта, без выделения памяти
+        if (str.capacity() > 15) {
+            totals.strings.bytes += str.size();
+            totals.strings.overhead += str.capacity() + 1 - str.size();
+        }
+    }
+
+    void Node(const json::Node& node, Totals& totals) {
+        totals.nodes.bytes += sizeof(json::Node);
+        if (node.IsString()) {
+            String(node.AsString(), totals);
+        } else if (node.IsArray()) {
+            const json::Array& array = node.AsArray();
+            totals.arrays.overhead += (array.capacity() - array.size()) * sizeof(json::Node);
+            for (const json::Node& item : array) {
+                Node(item, totals);
+            }
+        } else if (node.IsMap()) {
+            const json::Dict& dict = node.AsMap();
+            // Узел красно-чёрного дерева: цвет и три указателя
+            totals.dicts.bytes += dict.size() * sizeof(std::string);
+            totals.dicts.overhead += dict.size() * 4 * sizeof(void*);
+            for (const auto& [key, value] : dict) {
+                String(key, totals);
+                Node(value, totals);
+            }
+        }
+    }
+
+} // usage
+
 //----------- Document ----------
 
 Document::Document(Node root)
@@ -465,13 +960,199 @@ const json::Node& Document::GetRoot() const {
     return root_;
 }
 
+memory::Report Document::GetMemoryUsage() const {
+    usage::Totals totals;
+    usage::Node(root_, totals);
+    return {totals.nodes, totals.strings, totals.arrays, totals.dicts};
+}
+
+//----------- TreeBuilder ----------
+
+void TreeBuilder::StartObject() {
+    frames_.push_back({values_.size(), keys_.size()});
+}
+
+void TreeBuilder::EndObject() {
+    const Frame frame = frames_.back();
+    frames_.pop_back();
+    Dict dict;
+    for (size_t i = frame.keys_begin; i < keys_.size(); ++i) {
+        // Как и std::map::emplace: при повторе ключа остаётся первое значение
+        dict.emplace_hint(dict.end(), move(keys_[i]), move(values_[frame.values_begin + i - frame.keys_begin]));
+    }
+    keys_.resize(frame.keys_begin);
+    values_.resize(frame.values_begin);
+    values_.emplace_back(move(dict));
+}
+
+void TreeBuilder::StartArray() {
+    frames_.push_back({values_.size(), keys_.size()});
+}
+
+void TreeBuilder::EndArray() {
+    const Frame frame = frames_.back();
+    frames_.pop_back();
+    Array array(make_move_iterator(values_.begin() + static_cast<ptrdiff_t>(frame.values_begin)),
+                make_move_iterator(values_.end()));
+    values_.resize(frame.values_begin);
+    values_.emplace_back(move(array));
+}
+
+void TreeBuilder::Key(std::string_view key) {
+    keys_.emplace_back(key);
+}
+
+void TreeBuilder::String(std::string_view value) {
+    values_.emplace_back(std::string(value));
+}
+
+void TreeBuilder::Int(int value) {
+    values_.emplace_back(value);
+}
+
+void TreeBuilder::Double(double value) {
+    values_.emplace_back(value);
+}
+
+void TreeBuilder::Bool(bool value) {
+    values_.emplace_back(value);
+}
+
+void TreeBuilder::Null() {
+    values_.emplace_back(nullptr);
+}
+
+bool TreeBuilder::IsReady() const {
+    return frames_.empty() && values_.size() == 1;
+}
+
+Node TreeBuilder::Extract() {
+    Node result = move(values_.back());
+    values_.clear();
+    return result;
+}
+
+//----------- Parse ----------
+
+std::string ReadAll(istream& input) {
+    // Текст читается крупными блоками
+    std::string text;
+    char buffer[64 * 1024];
+    while (input.read(buffer, sizeof(buffer)) || input.gcount() > 0) {
+        text.append(buffer, static_cast<size_t>(input.gcount()));
+    }
+    return text;
+}
+
+Document Load(std::string_view text) {
+    TreeBuilder builder;
+    load::Parser<TreeBuilder> parser(text.data(), text.data() + text.size(), builder);
+    parser.ParseDocument();
+    return Document{builder.Extract()};
+}
+
 Document Load(istream& input) {
-    return Document{load::Node(input)};
+    return Load(std::string_view(ReadAll(input)));
+}
+
+void Parse(std::string_view text, EventHandler& handler) {
+    load::Parser<EventHandler> parser(text.data(), text.data() + text.size(), handler);
+    parser.ParseDocument();
+}
+
+void Parse(istream& input, EventHandler& handler) {
+    Parse(std::string_view(ReadAll(input)), handler);
+}
+
+// Идёт по индексу этапа 1: строки пропускаются парами кавычек, а вложенность
+// отслеживается по стеку открытых скобок
+std::optional<ArrayParts> SplitRootArray(std::string_view text, std::string_view key, size_t part_size) {
+    const char* end = text.data() + text.size();
+    load::StructuralIndex index(text.data(), end);
+    std::vector<char> open;
+    bool expect_key = false;
+    const char* array = nullptr;    // '[' искомого массива
+    const char* part = nullptr;     // начало текущего куска
+    const char* previous = nullptr;
+    ArrayParts result;
+    for (const char* token = index.Next(); token != end; previous = token, token = index.Next()) {
+        switch (*token) {
+        case '"': {
+            const char* close = index.Next();
+            if (close == end) {
+                return std::nullopt;
+            }
+            if (array != nullptr || !expect_key || open.size() != 1) {
+                break;
+            }
+            const std::string_view name(token + 1, static_cast<size_t>(close - token - 1));
+            if (name.find('\\') != std::string_view::npos) {
+                return std::nullopt;
+            }
+            expect_key = false;
+            if (name != key) {
+                break;
+            }
+            if ((token = index.Next()) == end || *token != ':' || (token = index.Next()) == end || *token != '[') {
+                return std::nullopt;
+            }
+            open.push_back('[');
+            array = token;
+            part = token + 1;
+            break;
+        }
+        case '{':
+        case '[':
+            if (open.empty() && *token != '{') {
+                return std::nullopt;
+            }
+            expect_key = open.empty();
+            open.push_back(*token);
+            break;
+        case '}':
+        case ']':
+            if (open.empty() || open.back() != (*token == '}' ? '{' : '[')) {
+                return std::nullopt;
+            }
+            open.pop_back();
+            if (array != nullptr && open.size() == 1) {
+                // У пустого массива кусков нет
+                if (previous != array) {
+                    result.parts.emplace_back(part, static_cast<size_t>(token - part));
+                }
+                result.array = std::string_view(array, static_cast<size_t>(token + 1 - array));
+                return result;
+            }
+            if (open.empty()) {
+                return std::nullopt;
+            }
+            break;
+        case ',':
+            if (open.size() == 1) {
+                expect_key = true;
+            } else if (array != nullptr && open.size() == 2 && static_cast<size_t>(token - part) >= part_size) {
+                result.parts.emplace_back(part, static_cast<size_t>(token - part));
+                part = token + 1;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return std::nullopt;
+}
+
+void ParseItems(std::string_view items, EventHandler& handler) {
+    load::Parser<EventHandler> parser(items.data(), items.data() + items.size(), handler);
+    parser.ParseItems();
+}
+
+void Print(const Document& doc, std::ostream& output, PrintOptions options) {
+    Writer(output, 0, options).Value(doc.GetRoot());
 }
 
-void Print(const Document& doc, std::ostream& output) {
-    output << std::setprecision(6);
-    print::Node(doc.GetRoot(),output,0);
+void Print(const Document& doc, Sink& output, PrintOptions options) {
+    Writer(output, 0, options).Value(doc.GetRoot());
 }
 
 }  // namespace json
\ No newline at end of file
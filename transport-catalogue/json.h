@@ -1,11 +1,18 @@
 #pragma once
 
+#include <cstring>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 
+#include "memory_usage.h"
+
 namespace json {
 
 class Node;
@@ -24,14 +31,18 @@ public:
 
     using Value = std::variant<std::nullptr_t,bool,int,double,std::string,Array,Dict>;
     Node() = default;
-    Node(Value var) : node_(var) {};
+    Node(Value var) : node_(std::move(var)) {};
     Node(std::nullptr_t np) : node_(np) {}
     Node(bool value) : node_(value){}
     Node(int value) : node_(value){}
     Node(double value) : node_(value){}
-    Node(const std::string& value) : node_(std::move(value)) {}
-    Node(const Array& array) : node_(std::move(array)) {}
-    Node(const Dict& map) : node_(std::move(map)) {}
+    Node(const std::string& value) : node_(value) {}
+    Node(const Array& array) : node_(array) {}
+    Node(const Dict& map) : node_(map) {}
+    // Разобранные массивы и словари переносятся в узел без копирования
+    Node(std::string&& value) : node_(std::move(value)) {}
+    Node(Array&& array) : node_(std::move(array)) {}
+    Node(Dict&& map) : node_(std::move(map)) {}
 
 
     bool IsInt() const;
@@ -74,6 +85,9 @@ public:
 
     const Node& GetRoot() const;
 
+    // Оценка памяти дерева: узлы, строки вне SSO-буфера, массивы и словари
+    memory::Report GetMemoryUsage() const;
+
     bool operator==(const Document& other) const{
         return (root_ == other.root_);
     }
@@ -85,9 +99,272 @@ private:
     Node root_;
 };
 
+// Обработчик событий потокового разбора: вместо дерева разбор сообщает о каждом
+// значении по мере чтения. Строки и ключи передаются как string_view:
+// - строка без escape-последовательностей - это часть разбираемого текста и
+//   действительна, пока жив текст (проверяется IsPartOf);
+// - раскодированная строка действительна только до возврата из обработчика.
+// По умолчанию события игнорируются
+class EventHandler {
+public:
+    virtual ~EventHandler() = default;
+
+    virtual void StartObject() {}
+    virtual void EndObject() {}
+    virtual void StartArray() {}
+    virtual void EndArray() {}
+    virtual void Key([[maybe_unused]] std::string_view key) {}
+    virtual void String([[maybe_unused]] std::string_view value) {}
+    // Целое, не помещающееся в int, приходит как Double
+    virtual void Int([[maybe_unused]] int value) {}
+    virtual void Double([[maybe_unused]] double value) {}
+    virtual void Bool([[maybe_unused]] bool value) {}
+    virtual void Null() {}
+};
+
+// Собирает из событий одно значение целиком. Можно передавать ему не весь
+// документ, а только события одного вложенного значения: после его окончания
+// IsReady() возвращает true, и значение забирается Extract().
+// При повторе ключа в словаре остаётся первое значение
+class TreeBuilder final : public EventHandler {
+public:
+    void StartObject() override;
+    void EndObject() override;
+    void StartArray() override;
+    void EndArray() override;
+    void Key(std::string_view key) override;
+    void String(std::string_view value) override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void Bool(bool value) override;
+    void Null() override;
+
+    bool IsReady() const;
+    Node Extract();
+
+private:
+    // Открытый массив или словарь: его элементы и ключи лежат в values_ и keys_
+    // начиная с этих позиций
+    struct Frame {
+        size_t values_begin;
+        size_t keys_begin;
+    };
+
+    std::vector<Node> values_;
+    std::vector<std::string> keys_;
+    std::vector<Frame> frames_;
+};
+
+// Лежит ли part внутри text: сравниваются адреса, а не содержимое
+inline bool IsPartOf(std::string_view part, std::string_view text) {
+    const std::less<const char*> less;
+    return !less(part.data(), text.data()) && !less(text.data() + text.size(), part.data() + part.size());
+}
+
+// Читает поток целиком
+std::string ReadAll(std::istream& input);
+
+// Разбирает текст, целиком лежащий в памяти.
+// В отличие от первого загрузчика из потока, ParsingError выбрасывается на:
+//   - незакрытый массив или словарь: [1,2  {"a":1
+//   - пропущенную запятую: [1 2]  {"a":1 "b":2}  и лишнюю в начале: [,1]  {,"a":1}
+//   - ведущие нули: 01  -01
+//   - число, за которым без разделителя идёт любой другой символ: 12a  1.5.3
+// Текст после корневого значения по-прежнему не проверяется: [1,2] x читается как [1,2].
+// То же относится к Parse, ParseItems и json::arena::Load - у них общий разборщик
+Document Load(std::string_view text);
+
 Document Load(std::istream& input);
 
-void Print(const Document& doc, std::ostream& output);
+// Разбирает текст, передавая события обработчику. Дерево не строится: кроме
+// самого текста, память разбора не зависит от его размера
+void Parse(std::string_view text, EventHandler& handler);
+
+// Текст читается целиком и живёт до конца разбора, поэтому все строки,
+// переданные обработчику, действительны только до возврата из Parse
+void Parse(std::istream& input, EventHandler& handler);
+
+// Массив, разделённый на куски по границам элементов
+struct ArrayParts {
+    // Текст массива от '[' до ']' включительно
+    std::string_view array;
+    // Элементы массива подряд через запятую; запятые между кусками не входят ни в один кусок
+    std::vector<std::string_view> parts;
+};
+
+// Быстрый просмотр структуры без разбора значений: находит массив - значение ключа key
+// корневого словаря (первого из повторяющихся) - и делит его на куски по границам
+// элементов, каждый длиной не меньше part_size, кроме последнего. nullopt, если ключа
+// нет, его значение - не массив, перед ним есть ключ с escape-последовательностью или
+// скобки не парны. Прочие ошибки в элементах находит разбор кусков
+std::optional<ArrayParts> SplitRootArray(std::string_view text, std::string_view key, size_t part_size);
+
+// Разбирает кусок из SplitRootArray: обработчик получает события элементов так же,
+// как внутри массива, но без StartArray и EndArray
+void ParseItems(std::string_view items, EventHandler& handler);
+
+// Вывод double: PRECISION - 6 значащих цифр, как printf("%g"); SHORTEST - кратчайшая
+// запись, которая читается обратно в то же самое число
+enum class DoubleFormat {
+    PRECISION,
+    SHORTEST
+};
+
+// Расположение текста: PRETTY - с переводами строк и отступом в 4 пробела на уровень
+// вложенности; COMPACT - без пробелов, для потребителей, которым не нужен читаемый вид
+enum class Layout {
+    PRETTY,
+    COMPACT
+};
+
+struct PrintOptions {
+    Layout layout = Layout::PRETTY;
+    DoubleFormat format = DoubleFormat::PRECISION;
+};
+
+// Приёмник текста для Writer и Print. Мелкие записи копируются в буфер, который
+// отдаётся получателю целиком, когда заполнится, и при Flush; запись длиннее
+// буфера отдаётся вместе с ним без копирования.
+// Наследники реализуют Send и отдают остаток буфера в деструкторе. Ошибки
+// записи в деструкторе не выбрасываются: чтобы их получить, вызовите Flush
+class Sink {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+
+    Sink(const Sink&) = delete;
+    Sink& operator=(const Sink&) = delete;
+    virtual ~Sink() = default;
+
+    void Write(const char* data, size_t size) {
+        if (size <= capacity_ - used_) {
+            std::memcpy(buffer_.get() + used_, data, size);
+            used_ += size;
+        } else {
+            Overflow(data, size);
+        }
+    }
+
+    void Write(std::string_view data) {
+        Write(data.data(), data.size());
+    }
+
+    void Put(char c) {
+        if (used_ == capacity_) {
+            Flush();
+        }
+        buffer_[used_++] = c;
+    }
+
+    void Flush();
+
+protected:
+    explicit Sink(size_t capacity);
+
+    // Отдаёт получателю сначала buffered, затем data; любая из частей может быть пустой
+    virtual void Send(std::string_view buffered, std::string_view data) = 0;
+
+    // Для деструкторов наследников
+    void FlushNoThrow() noexcept;
+
+private:
+    std::unique_ptr<char[]> buffer_;
+    size_t capacity_;
+    size_t used_ = 0;
+
+    void Overflow(const char* data, size_t size);
+};
+
+class StreamSink final : public Sink {
+public:
+    explicit StreamSink(std::ostream& output, size_t capacity = DEFAULT_CAPACITY);
+    ~StreamSink() override;
+
+private:
+    std::ostream& output_;
+
+    void Send(std::string_view buffered, std::string_view data) override;
+};
+
+// Дописывает текст в конец строки
+class StringSink final : public Sink {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    explicit StringSink(std::string& output, size_t capacity = DEFAULT_CAPACITY);
+    ~StringSink() override;
+
+private:
+    std::string& output_;
+
+    void Send(std::string_view buffered, std::string_view data) override;
+};
+
+// Пишет в файловый дескриптор через write/writev, минуя буферы iostream.
+// Дескриптор не закрывается. Ошибка записи выбрасывает std::system_error
+class FdSink final : public Sink {
+public:
+    explicit FdSink(int fd, size_t capacity = DEFAULT_CAPACITY);
+    ~FdSink() override;
+
+private:
+    int fd_;
+
+    void Send(std::string_view buffered, std::string_view data) override;
+};
+
+// Записывает JSON сразу, без построения дерева, в том же виде, что и Print.
+// Ключи словаря выводятся в порядке вызовов Key. Нарушение порядка вызовов
+// (Value в словаре без Key, лишний End*) выбрасывает std::logic_error
+class Writer {
+public:
+    // depth - уровень вложенности, с которого начинаются отступы: значение, отдельно
+    // записанное с depth = 1, можно вставить элементом массива через RawValue
+    explicit Writer(Sink& output, size_t depth = 0, PrintOptions options = {});
+    // Пишет в поток через собственный StreamSink: текст попадает в поток
+    // не позднее разрушения Writer
+    explicit Writer(std::ostream& output, size_t depth = 0, PrintOptions options = {});
+
+    Writer& StartDict();
+    Writer& EndDict();
+    Writer& StartArray();
+    Writer& EndArray();
+    Writer& Key(std::string_view key);
+
+    Writer& Value(std::nullptr_t);
+    Writer& Value(bool value);
+    Writer& Value(int value);
+    Writer& Value(double value);
+    Writer& Value(std::string_view value);
+    Writer& Value(const std::string& value);
+    Writer& Value(const char* value);
+    Writer& Value(const Node& node);
+
+    // Значение, уже записанное в формате JSON с тем же расположением и отступами своего уровня
+    Writer& RawValue(std::string_view json);
+
+private:
+    // Открытый массив или словарь
+    struct Level {
+        bool is_dict;
+        bool empty = true;
+        bool has_key = false;
+    };
+
+    std::unique_ptr<StreamSink> own_output_;
+    Sink* output_;
+    size_t depth_;
+    PrintOptions options_;
+    std::vector<Level> levels_;
+
+    void BeforeValue();
+    // Перевод строки и отступ текущего уровня; в COMPACT ничего не выводит
+    void NewLine();
+    void WriteString(std::string_view str);
+};
+
+void Print(const Document& doc, std::ostream& output, PrintOptions options = {});
+
+void Print(const Document& doc, Sink& output, PrintOptions options = {});
 
 }  // namespace json
 
@@ -0,0 +1,349 @@
+#include "json_arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace json::arena {
+
+static_assert(sizeof(Node) == 16);
+
+//----------- Array, Dict ----------
+
+const Node& Array::at(size_t index) const {
+    if (index >= size_) {
+        throw std::out_of_range("Array index out of range");
+    }
+    return items_[index];
+}
+
+const Member* Dict::find(std::string_view key) const {
+    const Member* it = std::lower_bound(begin(), end(), key, [](const Member& member, std::string_view key){
+        return member.key < key;
+    });
+    return it != end() && it->key == key ? it : end();
+}
+
+size_t Dict::count(std::string_view key) const {
+    return find(key) != end() ? 1 : 0;
+}
+
+const Node& Dict::at(std::string_view key) const {
+    const Member* it = find(key);
+    if (it == end()) {
+        throw std::out_of_range("Missing key \""s + std::string(key) + "\""s);
+    }
+    return it->value;
+}
+
+//----------- Node ----------
+
+bool Node::IsInt() const {
+    return type_ == Type::INT;
+}
+bool Node::IsDouble() const {
+    return type_ == Type::DOUBLE || type_ == Type::INT;
+}
+bool Node::IsPureDouble() const {
+    return type_ == Type::DOUBLE;
+}
+bool Node::IsBool() const {
+    return type_ == Type::BOOL;
+}
+bool Node::IsString() const {
+    return type_ == Type::STRING;
+}
+bool Node::IsNull() const {
+    return type_ == Type::NULL_VALUE;
+}
+bool Node::IsArray() const {
+    return type_ == Type::ARRAY;
+}
+bool Node::IsMap() const {
+    return type_ == Type::DICT;
+}
+
+int Node::AsInt() const {
+    if (!IsInt()) {
+        throw std::logic_error("Wrong value type");
+    }
+    return int_;
+}
+bool Node::AsBool() const {
+    if (!IsBool()) {
+        throw std::logic_error("Wrong value type");
+    }
+    return bool_;
+}
+double Node::AsDouble() const {
+    if (IsInt()) {
+        return static_cast<double>(int_);
+    }
+    if (!IsDouble()) {
+        throw std::logic_error("Wrong value type");
+    }
+    return double_;
+}
+std::string_view Node::AsString() const {
+    if (!IsString()) {
+        throw std::logic_error("Wrong value type");
+    }
+    return std::string_view(chars_, size_);
+}
+Array Node::AsArray() const {
+    if (!IsArray()) {
+        throw std::logic_error("Wrong value type");
+    }
+    return Array(items_, size_);
+}
+Dict Node::AsMap() const {
+    if (!IsMap()) {
+        throw std::logic_error("Wrong value type");
+    }
+    return Dict(members_, size_);
+}
+
+//----------- Document ----------
+
+class Document::Arena {
+public:
+    void* Allocate(size_t bytes, size_t alignment) {
+        used_ += bytes;
+        return resource_.allocate(bytes, alignment);
+    }
+
+    void SetSource(std::string&& source) {
+        source_ = std::move(source);
+    }
+
+    std::string_view GetSource() const {
+        return source_;
+    }
+
+    memory::Report GetMemoryUsage() const {
+        memory::Report report{{"json.arena", used_, upstream_.GetAllocated() - used_}};
+        if (!source_.empty()) {
+            report.push_back({"json.source", source_.size(), source_.capacity() - source_.size()});
+        }
+        return report;
+    }
+
+private:
+    // Первый блок арены; следующие растут в геометрической прогрессии
+    static constexpr size_t INITIAL_SIZE = 64 * 1024;
+
+    // Считает память, которую арена берёт у системы
+    class Upstream : public std::pmr::memory_resource {
+    public:
+        size_t GetAllocated() const {
+            return allocated_;
+        }
+
+    private:
+        size_t allocated_ = 0;
+
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            allocated_ += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    Upstream upstream_;
+    std::pmr::monotonic_buffer_resource resource_{INITIAL_SIZE, &upstream_};
+    size_t used_ = 0;
+    std::string source_;
+};
+
+Document::Document()
+    : arena_(std::make_unique<Arena>()) {
+}
+
+Document::Document(Document&& other) noexcept
+    : arena_(std::move(other.arena_))
+    , root_(std::exchange(other.root_, Node())) {
+}
+
+Document& Document::operator=(Document&& other) noexcept {
+    arena_ = std::move(other.arena_);
+    root_ = std::exchange(other.root_, Node());
+    return *this;
+}
+
+Document::~Document() = default;
+
+const Node& Document::GetRoot() const {
+    return root_;
+}
+
+std::string_view Document::GetSource() const {
+    return arena_ ? arena_->GetSource() : std::string_view();
+}
+
+memory::Report Document::GetMemoryUsage() const {
+    return arena_ ? arena_->GetMemoryUsage() : memory::Report();
+}
+
+//----------- Builder ----------
+
+Builder::Builder(std::string&& source) {
+    document_.arena_->SetSource(std::move(source));
+}
+
+std::string_view Builder::GetSource() const {
+    return document_.GetSource();
+}
+
+void Builder::StartObject() {
+    frames_.push_back({values_.size(), keys_.size()});
+}
+
+void Builder::EndObject() {
+    const Frame frame = frames_.back();
+    frames_.pop_back();
+    const size_t size = keys_.size() - frame.keys_begin;
+    Member* members = static_cast<Member*>(document_.arena_->Allocate(size * sizeof(Member), alignof(Member)));
+    for (size_t i = 0; i < size; ++i) {
+        new (members + i) Member{keys_[frame.keys_begin + i], values_[frame.values_begin + i]};
+    }
+    // Сортировка устойчивая, поэтому из повторяющихся ключей unique оставляет первый.
+    // Словари документа обычно малы, и сортировка вставками обходится без буфера,
+    // который выделил бы stable_sort
+    const auto by_key = [](const Member& lhs, const Member& rhs){ return lhs.key < rhs.key; };
+    if (size <= INSERTION_SORT_SIZE) {
+        for (size_t i = 1; i < size; ++i) {
+            const Member member = members[i];
+            size_t j = i;
+            for (; j > 0 && by_key(member, members[j - 1]); --j) {
+                members[j] = members[j - 1];
+            }
+            members[j] = member;
+        }
+    } else {
+        std::stable_sort(members, members + size, by_key);
+    }
+    const auto same_key = [](const Member& lhs, const Member& rhs){ return lhs.key == rhs.key; };
+    const size_t unique_size = static_cast<size_t>(std::unique(members, members + size, same_key) - members);
+    keys_.resize(frame.keys_begin);
+    values_.resize(frame.values_begin);
+
+    Node node;
+    node.type_ = Node::Type::DICT;
+    node.size_ = static_cast<uint32_t>(unique_size);
+    node.members_ = members;
+    values_.push_back(node);
+}
+
+void Builder::StartArray() {
+    frames_.push_back({values_.size(), keys_.size()});
+}
+
+void Builder::EndArray() {
+    const Frame frame = frames_.back();
+    frames_.pop_back();
+    const size_t size = values_.size() - frame.values_begin;
+    Node* items = static_cast<Node*>(document_.arena_->Allocate(size * sizeof(Node), alignof(Node)));
+    std::uninitialized_copy(values_.begin() + static_cast<ptrdiff_t>(frame.values_begin), values_.end(), items);
+    values_.resize(frame.values_begin);
+
+    Node node;
+    node.type_ = Node::Type::ARRAY;
+    node.size_ = static_cast<uint32_t>(size);
+    node.items_ = items;
+    values_.push_back(node);
+}
+
+void Builder::Key(std::string_view key) {
+    keys_.push_back(StoreString(key));
+}
+
+void Builder::String(std::string_view value) {
+    const std::string_view copy = StoreString(value);
+    Node node;
+    node.type_ = Node::Type::STRING;
+    node.size_ = static_cast<uint32_t>(copy.size());
+    node.chars_ = copy.data();
+    values_.push_back(node);
+}
+
+void Builder::Int(int value) {
+    Node node;
+    node.type_ = Node::Type::INT;
+    node.int_ = value;
+    values_.push_back(node);
+}
+
+void Builder::Double(double value) {
+    Node node;
+    node.type_ = Node::Type::DOUBLE;
+    node.double_ = value;
+    values_.push_back(node);
+}
+
+void Builder::Bool(bool value) {
+    Node node;
+    node.type_ = Node::Type::BOOL;
+    node.bool_ = value;
+    values_.push_back(node);
+}
+
+void Builder::Null() {
+    values_.push_back(Node());
+}
+
+bool Builder::IsReady() const {
+    return frames_.empty() && values_.size() == 1;
+}
+
+Document Builder::Extract() {
+    Document result = std::move(document_);
+    result.root_ = values_.back();
+    values_.clear();
+    document_ = Document();
+    return result;
+}
+
+std::string_view Builder::StoreString(std::string_view str) {
+    if (str.empty()) {
+        return {};
+    }
+    if (IsPartOf(str, document_.GetSource())) {
+        return str;
+    }
+    char* chars = static_cast<char*>(document_.arena_->Allocate(str.size(), 1));
+    std::memcpy(chars, str.data(), str.size());
+    return std::string_view(chars, str.size());
+}
+
+//----------- Load ----------
+
+Document Load(std::string_view text) {
+    Builder builder;
+    Parse(text, builder);
+    return builder.Extract();
+}
+
+Document Load(std::string&& text) {
+    Builder builder(std::move(text));
+    Parse(builder.GetSource(), builder);
+    return builder.Extract();
+}
+
+Document Load(std::istream& input) {
+    return Load(ReadAll(input));
+}
+
+}  // namespace json::arena
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "json.h"
+#include "memory_usage.h"
+
+// Компактное дерево JSON для чтения больших документов. Узлы, элементы массивов,
+// пары словарей и строки лежат в арене документа: загрузка делает несколько
+// крупных выделений памяти вместо выделения на каждый узел, ключ и строку,
+// а освобождение документа возвращает их разом.
+// Документ может владеть исходным текстом: тогда строки и ключи без
+// escape-последовательностей не копируются, а ссылаются на текст.
+// Узлы и строки действительны, пока жив Document (перемещение документа их не затрагивает)
+namespace json::arena {
+
+class Node;
+struct Member;
+
+// Элементы массива, лежащие подряд
+class Array {
+public:
+    Array() = default;
+    Array(const Node* items, size_t size)
+        : items_(items)
+        , size_(size) {
+    }
+
+    const Node* begin() const;
+    const Node* end() const;
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    const Node& operator[](size_t index) const;
+    const Node& at(size_t index) const;
+
+private:
+    const Node* items_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Пары словаря, отсортированные по ключу так же, как в json::Dict.
+// При повторе ключа в документе остаётся первое значение
+class Dict {
+public:
+    Dict() = default;
+    Dict(const Member* members, size_t size)
+        : members_(members)
+        , size_(size) {
+    }
+
+    const Member* begin() const;
+    const Member* end() const;
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    // Двоичный поиск; end(), если ключа нет
+    const Member* find(std::string_view key) const;
+    size_t count(std::string_view key) const;
+    // Выбрасывает std::out_of_range, если ключа нет
+    const Node& at(std::string_view key) const;
+
+private:
+    const Member* members_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Узел занимает 16 байт: тип, длина строки или число элементов и значение либо
+// указатель в арену. Интерфейс чтения тот же, что у json::Node
+class Node {
+public:
+    Node() = default;
+
+    bool IsInt() const;
+    bool IsDouble() const;
+    bool IsPureDouble() const;
+    bool IsBool() const;
+    bool IsString() const;
+    bool IsNull() const;
+    bool IsArray() const;
+    bool IsMap() const;
+
+    int AsInt() const;
+    bool AsBool() const;
+    // Возвращает значение типа double, если внутри хранится double либо int
+    double AsDouble() const;
+    std::string_view AsString() const;
+    Array AsArray() const;
+    Dict AsMap() const;
+
+private:
+    friend class Builder;
+
+    enum class Type : uint8_t {
+        NULL_VALUE,
+        BOOL,
+        INT,
+        DOUBLE,
+        STRING,
+        ARRAY,
+        DICT
+    };
+
+    Type type_ = Type::NULL_VALUE;
+    uint32_t size_ = 0;
+    union {
+        bool bool_;
+        int int_;
+        double double_;
+        const char* chars_ = nullptr;
+        const Node* items_;
+        const Member* members_;
+    };
+};
+
+struct Member {
+    std::string_view key;
+    Node value;
+};
+
+inline const Node* Array::begin() const {
+    return items_;
+}
+inline const Node* Array::end() const {
+    return items_ + size_;
+}
+inline const Node& Array::operator[](size_t index) const {
+    return items_[index];
+}
+
+inline const Member* Dict::begin() const {
+    return members_;
+}
+inline const Member* Dict::end() const {
+    return members_ + size_;
+}
+
+class Document {
+public:
+    // Пустой документ: корень - null
+    Document();
+    // Перемещённый документ остаётся без арены: корень - null, текста нет,
+    // отчёт о памяти пуст. Новые значения в нём не строятся
+    Document(Document&& other) noexcept;
+    Document& operator=(Document&& other) noexcept;
+    ~Document();
+
+    const Node& GetRoot() const;
+
+    // Исходный текст, если документ им владеет, иначе пустая строка
+    std::string_view GetSource() const;
+
+    // Память арены: bytes - занятая узлами и строками, overhead - остаток блоков;
+    // и исходного текста, если документ им владеет
+    memory::Report GetMemoryUsage() const;
+
+private:
+    friend class Builder;
+
+    class Arena;
+
+    std::unique_ptr<Arena> arena_;
+    Node root_;
+};
+
+// Собирает документ из событий разбора. Как и json::TreeBuilder, может получать
+// события одного значения или документа целиком; после окончания значения
+// IsReady() возвращает true, и документ забирается Extract()
+class Builder final : public EventHandler {
+public:
+    // Строки копируются в арену
+    Builder() = default;
+    // Документ забирает текст, который затем разбирается (GetSource()):
+    // строки, лежащие в нём, не копируются. Следующий после Extract документ
+    // текстом уже не владеет
+    explicit Builder(std::string&& source);
+
+    std::string_view GetSource() const;
+
+    void StartObject() override;
+    void EndObject() override;
+    void StartArray() override;
+    void EndArray() override;
+    void Key(std::string_view key) override;
+    void String(std::string_view value) override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void Bool(bool value) override;
+    void Null() override;
+
+    bool IsReady() const;
+    Document Extract();
+
+private:
+    struct Frame {
+        size_t values_begin;
+        size_t keys_begin;
+    };
+
+    static constexpr size_t INSERTION_SORT_SIZE = 32;
+
+    Document document_;
+    // Значения и ключи открытых массивов и словарей; память переиспользуется
+    std::vector<Node> values_;
+    std::vector<std::string_view> keys_;
+    std::vector<Frame> frames_;
+
+    std::string_view StoreString(std::string_view str);
+};
+
+// Строки копируются в арену, text после загрузки не нужен
+Document Load(std::string_view text);
+
+// Документ владеет текстом и ссылается на строки в нём
+Document Load(std::string&& text);
+
+// Поток читается целиком, и документ владеет прочитанным текстом
+Document Load(std::istream& input);
+
+}  // namespace json::arena
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <charconv>
+#include <optional>
+#include <string>
+#include <system_error>
+
+#include "json.h"
+
+// Разбор и печать чисел JSON через from_chars/to_chars: без локали,
+// без промежуточных строк и без исключений в обычном случае
+namespace json::number {
+
+    // Буфер такой длины вмещает любой int и double в любом из форматов
+    inline constexpr size_t MAX_LENGTH = 32;
+
+    // Точность формата DoubleFormat::PRECISION, как у прежнего вывода через setprecision(6)
+    inline constexpr int PRECISION = 6;
+
+    // Целое без дробной части и экспоненты: значение, если оно помещается в int
+    inline std::optional<int> ParseInt(const char* begin, const char* end) {
+        int value = 0;
+        const auto [ptr, error] = std::from_chars(begin, end, value);
+        if (error != std::errc() || ptr != end) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    // Число, уже проверенное по грамматике JSON. Выбрасывает ParsingError,
+    // если оно не помещается в double
+    inline double ParseDouble(const char* begin, const char* end) {
+        double value = 0;
+        const auto [ptr, error] = std::from_chars(begin, end, value);
+        if (error != std::errc() || ptr != end) {
+            throw ParsingError("Failed to convert " + std::string(begin, end) + " to number");
+        }
+        return value;
+    }
+
+    // Печатают число в buffer длиной не меньше MAX_LENGTH и возвращают конец записи
+    inline char* Format(int value, char* buffer) {
+        return std::to_chars(buffer, buffer + MAX_LENGTH, value).ptr;
+    }
+
+    inline char* Format(double value, char* buffer, DoubleFormat format) {
+        if (format == DoubleFormat::SHORTEST) {
+            return std::to_chars(buffer, buffer + MAX_LENGTH, value).ptr;
+        }
+        return std::to_chars(buffer, buffer + MAX_LENGTH, value, std::chars_format::general, PRECISION).ptr;
+    }
+
+}
@@ -1,5 +1,11 @@
 #include "json_reader.h"
+#include "parallel.h"
+#include "perfect_hash.h"
+#include <algorithm>
+#include <deque>
+#include <exception>
 #include <sstream>
+#include <stdexcept>
 
 namespace json_reader {
 
@@ -20,80 +26,684 @@ namespace json_reader {
         catalogue_ = &catalogue;    
     }
 
+    void JsonReader::SetThreadCount(size_t thread_count) {
+        thread_count_ = thread_count;
+    }
+
+    void JsonReader::SetMemoryAccounting(bool enabled) {
+        memory_accounting_ = enabled;
+    }
+
+    void JsonReader::SetPrintOptions(const json::PrintOptions& options) {
+        print_options_ = options;
+    }
+
+    const memory::Report& JsonReader::GetDocumentMemoryUsage() const {
+        return document_memory_;
+    }
+
+// ---------- Base requests ----------
+
+    namespace {
+
+        // Поля записи base_requests, которые читает JsonReader
+        enum class Field {
+            TYPE,
+            ACTION,
+            NAME,
+            LATITUDE,
+            LONGITUDE,
+            ROAD_DISTANCES,
+            STOPS,
+            IS_ROUNDTRIP,
+            FROM,
+            TO,
+            DISTANCE,
+            OTHER
+        };
+
+        constexpr std::string_view FIELD_KEYS[] = {
+            "type", "action", "name", "latitude", "longitude", "road_distances",
+            "stops", "is_roundtrip", "from", "to", "distance"
+        };
+        constexpr perfect_hash::KeyTable FIELDS(FIELD_KEYS);
+        static_assert(FIELDS.NOT_FOUND == static_cast<size_t>(Field::OTHER));
+
+        Field ParseField(std::string_view key) {
+            return static_cast<Field>(FIELDS.Find(key));
+        }
+
+        // Значения "type" записи base_requests
+        enum class RecordType {
+            STOP,
+            BUS,
+            DISTANCE,
+            OTHER
+        };
+
+        constexpr std::string_view RECORD_TYPE_KEYS[] = {"Stop", "Bus", "Distance"};
+        constexpr perfect_hash::KeyTable RECORD_TYPES(RECORD_TYPE_KEYS);
+        static_assert(RECORD_TYPES.NOT_FOUND == static_cast<size_t>(RecordType::OTHER));
+
+        // Значения "action" в порядке JsonReader::Action
+        constexpr std::string_view ACTION_KEYS[] = {"add", "replace", "remove"};
+        constexpr perfect_hash::KeyTable ACTIONS(ACTION_KEYS);
+
+        // Значения "type" запроса stat_requests в порядке domain::request::Type
+        constexpr std::string_view REQUEST_TYPE_KEYS[] = {
+            "Stop", "Bus", "Map", "Route", "NearestStops", "StopsInBox", "StopSearch"
+        };
+        constexpr perfect_hash::KeyTable REQUEST_TYPES(REQUEST_TYPE_KEYS);
+        static_assert(static_cast<size_t>(domain::request::Type::STOP_SEARCH) + 1 == REQUEST_TYPES.NOT_FOUND);
+
+        [[noreturn]] void ThrowWrongType() {
+            throw std::logic_error("Wrong value type");
+        }
+
+    }
+
+    // Запись base_requests. Строковые поля ссылаются на входной текст, а раскодированные
+    // строки с escape-последовательностями - на память InputHandler или BaseChunk. Имена остановок
+    // в stops и road_distances интернированы, если запись разобрана не в BaseChunk
+    struct JsonReader::BaseRecord {
+        uint32_t present = 0;
+        std::string_view type;
+        std::string_view action;
+        std::string_view name;
+        std::string_view from;
+        std::string_view to;
+        geo::Coordinates coordinates;
+        double distance = 0;
+        bool is_roundtrip = false;
+        std::vector<std::pair<std::string_view,double>> road_distances;
+        std::vector<std::string_view> stops;
+
+        bool Has(Field field) const {
+            return present & (1u << static_cast<uint32_t>(field));
+        }
+
+        void Set(Field field) {
+            present |= 1u << static_cast<uint32_t>(field);
+        }
+
+        // Как json::Dict::at, выбрасывает std::out_of_range при отсутствии поля
+        void Require(Field field) const {
+            if (!Has(field)) {
+                throw std::out_of_range("Missing key \"" + std::string(FIELD_KEYS[static_cast<size_t>(field)])
+                                        + "\" in base request");
+            }
+        }
+
+        void Clear() {
+            present = 0;
+            road_distances.clear();
+            stops.clear();
+        }
+    };
+
+    // Записи куска base_requests, разобранного в отдельном потоке. Имена остановок
+    // не интернированы: каталог не потокобезопасен, и это делает ApplyBaseChunk.
+    // Раскодированные строки записей хранятся в unescaped
+    struct JsonReader::BaseChunk {
+        std::vector<BaseRecord> records;
+        std::deque<std::string> unescaped;
+        // Ошибка разбора куска: записи до неё уже в records
+        std::exception_ptr error;
+
+        void Clear() {
+            records.clear();
+            unescaped.clear();
+            error = nullptr;
+        }
+    };
+
+    // Разбирает корневой словарь. Раздел base_requests читается по событиям:
+    // каждая запись собирается в BaseRecord и сразу передаётся в ParseBaseRequest.
+    // Остальные разделы собираются в компактный документ, корень которого - словарь
+    // разделов. Как и при разборе в дерево, из повторяющихся ключей учитывается первый
+    class JsonReader::InputHandler final : public json::EventHandler {
+        public:
+            // Строки записи ссылаются на text, пока она разбирается. Документ разделов
+            // строки копирует: он живёт дольше текста и занимает много меньше
+            InputHandler(JsonReader& reader, std::string_view text)
+                : reader_(reader)
+                , text_(text) {
+            }
+
+            // Разбирает элементы base_requests (json::ParseItems) и складывает записи
+            // в chunk, не обращаясь к reader: так можно разбирать куски параллельно
+            InputHandler(JsonReader& reader, std::string_view text, BaseChunk& chunk)
+                : reader_(reader)
+                , text_(text)
+                , state_(State::BASE)
+                , chunk_(&chunk) {
+            }
+
+            json::arena::Document ExtractSections() {
+                return sections_.Extract();
+            }
+
+            void StartObject() override {
+                switch (state_) {
+                case State::START:
+                    sections_.StartObject();
+                    state_ = State::ROOT;
+                    break;
+                case State::SECTION:
+                    sections_.StartObject();
+                    ++section_depth_;
+                    break;
+                case State::BASE:
+                    record_.Clear();
+                    state_ = State::RECORD;
+                    break;
+                case State::RECORD:
+                    if (field_ == Field::ROAD_DISTANCES) {
+                        record_.Set(Field::ROAD_DISTANCES);
+                        state_ = State::ROAD_DISTANCES;
+                    } else {
+                        StartContainer();
+                    }
+                    break;
+                case State::SKIP:
+                    ++skip_depth_;
+                    break;
+                default:
+                    ThrowWrongType();
+                }
+            }
+
+            void EndObject() override {
+                switch (state_) {
+                case State::ROOT:
+                    sections_.EndObject();
+                    state_ = State::DONE;
+                    break;
+                case State::SECTION:
+                    sections_.EndObject();
+                    --section_depth_;
+                    FinishSection();
+                    break;
+                case State::RECORD:
+                    if (chunk_ != nullptr) {
+                        chunk_->records.push_back(std::move(record_));
+                    } else {
+                        reader_.ParseBaseRequest(record_);
+                    }
+                    state_ = State::BASE;
+                    break;
+                case State::ROAD_DISTANCES:
+                    state_ = State::RECORD;
+                    break;
+                default:
+                    EndContainer();
+                }
+            }
+
+            void StartArray() override {
+                switch (state_) {
+                case State::SECTION:
+                    sections_.StartArray();
+                    ++section_depth_;
+                    break;
+                case State::BASE_KEY:
+                    state_ = State::BASE;
+                    break;
+                case State::RECORD:
+                    if (field_ == Field::STOPS) {
+                        record_.Set(Field::STOPS);
+                        state_ = State::STOPS;
+                    } else {
+                        StartContainer();
+                    }
+                    break;
+                case State::SKIP:
+                    ++skip_depth_;
+                    break;
+                default:
+                    ThrowWrongType();
+                }
+            }
+
+            void EndArray() override {
+                switch (state_) {
+                case State::SECTION:
+                    sections_.EndArray();
+                    --section_depth_;
+                    FinishSection();
+                    break;
+                case State::BASE:
+                    state_ = State::ROOT;
+                    break;
+                case State::STOPS:
+                    state_ = State::RECORD;
+                    break;
+                default:
+                    EndContainer();
+                }
+            }
+
+            void Key(std::string_view key) override {
+                switch (state_) {
+                case State::ROOT:
+                    if (key == "base_requests" && !base_found_) {
+                        base_found_ = true;
+                        state_ = State::BASE_KEY;
+                    } else {
+                        sections_.Key(key);
+                        state_ = State::SECTION;
+                    }
+                    break;
+                case State::SECTION:
+                    sections_.Key(key);
+                    break;
+                case State::RECORD:
+                    field_ = ParseField(key);
+                    if (field_ != Field::OTHER && record_.Has(field_)) {
+                        field_ = Field::OTHER;
+                    }
+                    break;
+                case State::ROAD_DISTANCES:
+                    distance_stop_ = StopName(key);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            void String(std::string_view value) override {
+                if (state_ == State::SECTION) {
+                    sections_.String(value);
+                    FinishSection();
+                } else if (state_ == State::STOPS) {
+                    record_.stops.push_back(StopName(value));
+                } else if (IsRecordField()) {
+                    switch (field_) {
+                    case Field::TYPE:
+                        record_.type = Keep(value);
+                        break;
+                    case Field::ACTION:
+                        record_.action = Keep(value);
+                        break;
+                    case Field::NAME:
+                        record_.name = Keep(value);
+                        break;
+                    case Field::FROM:
+                        record_.from = Keep(value);
+                        break;
+                    case Field::TO:
+                        record_.to = Keep(value);
+                        break;
+                    default:
+                        ThrowWrongType();
+                    }
+                    record_.Set(field_);
+                }
+            }
+
+            void Int(int value) override {
+                if (state_ == State::SECTION) {
+                    sections_.Int(value);
+                    FinishSection();
+                } else {
+                    Number(value);
+                }
+            }
+
+            void Double(double value) override {
+                if (state_ == State::SECTION) {
+                    sections_.Double(value);
+                    FinishSection();
+                } else {
+                    Number(value);
+                }
+            }
+
+            void Bool(bool value) override {
+                if (state_ == State::SECTION) {
+                    sections_.Bool(value);
+                    FinishSection();
+                } else if (IsRecordField()) {
+                    if (field_ != Field::IS_ROUNDTRIP) {
+                        ThrowWrongType();
+                    }
+                    record_.is_roundtrip = value;
+                    record_.Set(field_);
+                }
+            }
+
+            void Null() override {
+                if (state_ == State::SECTION) {
+                    sections_.Null();
+                    FinishSection();
+                } else if (IsRecordField()) {
+                    ThrowWrongType();
+                }
+            }
+
+        private:
+            enum class State {
+                START,
+                ROOT,
+                SECTION,            // значение раздела, кроме base_requests
+                BASE_KEY,           // после ключа base_requests
+                BASE,               // в массиве base_requests
+                RECORD,             // в записи base_requests
+                ROAD_DISTANCES,
+                STOPS,
+                SKIP,               // в массиве или словаре неизвестного поля записи
+                DONE
+            };
+
+            JsonReader& reader_;
+            std::string_view text_;
+            State state_ = State::START;
+            BaseChunk* chunk_ = nullptr;
+            json::arena::Builder sections_;
+            size_t section_depth_ = 0;
+            bool base_found_ = false;
+            BaseRecord record_;
+            // Память раскодированных строк записи, переиспользуется от записи к записи
+            std::string unescaped_[static_cast<size_t>(Field::OTHER)];
+            Field field_ = Field::OTHER;
+            std::string_view distance_stop_;
+            size_t skip_depth_ = 0;
+
+            // Строка из текста остаётся ссылкой на него, раскодированная - копируется
+            std::string_view Keep(std::string_view value) {
+                if (json::IsPartOf(value, text_)) {
+                    return value;
+                }
+                if (chunk_ != nullptr) {
+                    return chunk_->unescaped.emplace_back(value);
+                }
+                std::string& storage = unescaped_[static_cast<size_t>(field_)];
+                storage = value;
+                return storage;
+            }
+
+            // Имя остановки интернируется сразу, а в куске - хранится до ApplyBaseChunk
+            std::string_view StopName(std::string_view name) {
+                if (chunk_ == nullptr) {
+                    return reader_.catalogue_->InternName(name);
+                }
+                if (json::IsPartOf(name, text_)) {
+                    return name;
+                }
+                return chunk_->unescaped.emplace_back(name);
+            }
+
+            void FinishSection() {
+                if (section_depth_ == 0) {
+                    state_ = State::ROOT;
+                }
+            }
+
+            // Скаляр, пришедший значением поля записи: неизвестные поля пропускаются,
+            // значения вне записи (в SKIP - внутри пропускаемого поля) не допускаются
+            bool IsRecordField() {
+                if (state_ == State::RECORD) {
+                    return field_ != Field::OTHER;
+                }
+                if (state_ != State::SKIP) {
+                    ThrowWrongType();
+                }
+                return false;
+            }
+
+            void Number(double value) {
+                if (state_ == State::ROAD_DISTANCES) {
+                    auto& distances = record_.road_distances;
+                    const auto same_stop = [this](const auto& distance){ return distance.first == distance_stop_; };
+                    if (std::find_if(distances.begin(), distances.end(), same_stop) == distances.end()) {
+                        distances.push_back({distance_stop_, value});
+                    }
+                } else if (IsRecordField()) {
+                    switch (field_) {
+                    case Field::LATITUDE:
+                        record_.coordinates.lat = value;
+                        break;
+                    case Field::LONGITUDE:
+                        record_.coordinates.lng = value;
+                        break;
+                    case Field::DISTANCE:
+                        record_.distance = value;
+                        break;
+                    default:
+                        ThrowWrongType();
+                    }
+                    record_.Set(field_);
+                }
+            }
+
+            // Массив или словарь значением поля записи: неизвестное поле пропускается целиком
+            void StartContainer() {
+                if (field_ != Field::OTHER) {
+                    ThrowWrongType();
+                }
+                skip_depth_ = 1;
+                state_ = State::SKIP;
+            }
+
+            void EndContainer() {
+                if (state_ == State::SKIP && --skip_depth_ == 0) {
+                    state_ = State::RECORD;
+                }
+            }
+    };
+
 // ---------- JSON Parsing ----------
 
     domain::ParsedInput JsonReader::ParseJson(std::istream& input) {
-        commands_ptr_ = new domain::ParsedInput;
-        json::Document requests = json::Load(input);
-        json::Array base = requests.GetRoot().AsMap().at("base_requests").AsArray();
-        json::Array stat = requests.GetRoot().AsMap().at("stat_requests").AsArray();
-        for (auto& request : base) {
-            json::Dict data = request.AsMap();
-            if (data.at("type").AsString() == "Stop"){
-                AddStopCommand(ParseName(data),ParseCoordinates(data),ParseDistances(data));
+        domain::ParsedInput commands;
+        commands_ptr_ = &commands;
+        json::arena::Document requests;
+        {
+            std::string text = json::ReadAll(input);
+            std::optional<json::ArrayParts> base;
+            if (thread_count_ > 1) {
+                base = json::SplitRootArray(text, "base_requests", PARSE_PART_SIZE);
             }
-            else if (data.at("type").AsString() == "Bus"){
-                AddBusCommand(ParseName(data),ParseRoundtrip(data),ParseStops(data));
+            if (base && base->parts.size() > 1) {
+                ParseBaseRequests(base->parts, text);
+                // Команды уже не ссылаются на текст base_requests: элементы массива
+                // затираются пробелами, и остальные разделы разбираются как обычно
+                const size_t array_begin = static_cast<size_t>(base->array.data() - text.data());
+                std::fill_n(text.begin() + static_cast<ptrdiff_t>(array_begin + 1), base->array.size() - 2, ' ');
             }
+            InputHandler handler(*this, text);
+            json::Parse(text, handler);
+            requests = handler.ExtractSections();
+        }
+        if (memory_accounting_) {
+            document_memory_ = requests.GetMemoryUsage();
         }
-        if (requests.GetRoot().AsMap().count("render_settings")) {
-            json::Dict svg_settings = requests.GetRoot().AsMap().at("render_settings").AsMap();
-            map_renderer_->SetSettings(ParseMapSettings(svg_settings));
+        const json::arena::Dict root = requests.GetRoot().AsMap();
+        if (root.count("render_settings")) {
+            map_renderer_->SetSettings(ParseMapSettings(root.at("render_settings").AsMap()));
         }
-        if (requests.GetRoot().AsMap().count("routing_settings")) {
-            json::Dict route_settings = requests.GetRoot().AsMap().at("routing_settings").AsMap();
-            router_->SetSettings(ParseRouteSettings(route_settings));
+        if (root.count("routing_settings")) {
+            router_->SetSettings(ParseRouteSettings(root.at("routing_settings").AsMap()));
         }
-        for (auto& request : stat){
-            json::Dict data = request.AsMap();
-            if (data.at("type").AsString() == "Stop") {
-                AddRequest({data.at("id").AsInt(),data.at("name").AsString(),domain::request::Type::STOP,""});
-            } else if (data.at("type").AsString() == "Bus") {
-                AddRequest({data.at("id").AsInt(),data.at("name").AsString(),domain::request::Type::BUS,""});
-            } else if (data.at("type").AsString() == "Map") {
-                AddRequest({data.at("id").AsInt(),"",domain::request::Type::MAP,""});
-            } else if (data.at("type").AsString() == "Route") {
+        if (root.count("serialization_settings")) {
+            commands.serialization_file = root.at("serialization_settings").AsMap().at("file").AsString();
+        }
+        const json::arena::Array stat = root.count("stat_requests") ? root.at("stat_requests").AsArray() : json::arena::Array{};
+        for (const auto& request : stat){
+            const json::arena::Dict data = request.AsMap();
+            // Запросы неизвестного типа пропускаются
+            const size_t type_index = REQUEST_TYPES.Find(data.at("type").AsString());
+            if (type_index == REQUEST_TYPES.NOT_FOUND) {
+                continue;
+            }
+            const auto type = static_cast<domain::request::Type>(type_index);
+            switch (type) {
+            case domain::request::Type::STOP:
+            case domain::request::Type::BUS:
+                AddRequest({data.at("id").AsInt(),std::string(data.at("name").AsString()),type,""});
+                break;
+            case domain::request::Type::MAP:
+                AddRequest({data.at("id").AsInt(),"",type,""});
+                break;
+            case domain::request::Type::ROUTE:
                 AddRequest({data.at("id").AsInt(),
-                            data.at("from").AsString(),
-                            domain::request::Type::ROUTE,
-                            data.at("to").AsString()});
+                            std::string(data.at("from").AsString()),
+                            type,
+                            std::string(data.at("to").AsString())});
+                break;
+            case domain::request::Type::NEAREST_STOPS: {
+                domain::request::Command command {data.at("id").AsInt(),"",type,""};
+                command.point = ParseCoordinates(data);
+                command.count = data.at("count").AsInt();
+                AddRequest(command);
+                break;
+            }
+            case domain::request::Type::STOPS_IN_BOX: {
+                domain::request::Command command {data.at("id").AsInt(),"",type,""};
+                command.point = {data.at("min_latitude").AsDouble(),data.at("min_longitude").AsDouble()};
+                command.point_to = {data.at("max_latitude").AsDouble(),data.at("max_longitude").AsDouble()};
+                AddRequest(command);
+                break;
+            }
+            case domain::request::Type::STOP_SEARCH: {
+                domain::request::Command command {data.at("id").AsInt(),std::string(data.at("prefix").AsString()),type,""};
+                command.count = data.at("count").AsInt();
+                AddRequest(command);
+                break;
+            }
+            }
+        }
+        commands_ptr_ = nullptr;
+        return commands;
+    }
+
+    // Куски разбираются порциями по thread_count_ штук, а записи порции применяются
+    // по порядку в вызывающем потоке, как при последовательном разборе. Ошибка куска
+    // выбрасывается после его записей, предшествующих ей
+    void JsonReader::ParseBaseRequests(const std::vector<std::string_view>& parts, std::string_view text) {
+        std::vector<BaseChunk> chunks(std::min(parts.size(), thread_count_));
+        for (size_t first = 0; first < parts.size(); first += chunks.size()) {
+            const size_t count = std::min(chunks.size(), parts.size() - first);
+            parallel::ForRanges(count, thread_count_, [this, &parts, &chunks, text, first](size_t begin, size_t end){
+                for (size_t i = begin; i < end; ++i) {
+                    BaseChunk& chunk = chunks[i];
+                    chunk.Clear();
+                    try {
+                        InputHandler handler(*this, text, chunk);
+                        json::ParseItems(parts[first + i], handler);
+                    } catch (...) {
+                        chunk.error = std::current_exception();
+                    }
+                }
+            });
+            for (size_t i = 0; i < count; ++i) {
+                ApplyBaseChunk(chunks[i]);
+            }
+        }
+    }
+
+    void JsonReader::ApplyBaseChunk(BaseChunk& chunk) {
+        for (BaseRecord& record : chunk.records) {
+            for (std::string_view& stop : record.stops) {
+                stop = catalogue_->InternName(stop);
+            }
+            for (auto& [stop, distance] : record.road_distances) {
+                stop = catalogue_->InternName(stop);
+            }
+            ParseBaseRequest(record);
+        }
+        if (chunk.error) {
+            std::rethrow_exception(chunk.error);
+        }
+    }
+
+    void JsonReader::ParseBaseRequest(const BaseRecord& data) {
+        data.Require(Field::TYPE);
+        const auto type = static_cast<RecordType>(RECORD_TYPES.Find(data.type));
+        const Action action = ParseAction(data);
+        domain::command::Updates& updates = commands_ptr_->updates;
+        if (type == RecordType::STOP){
+            if (action == Action::ADD) {
+                AddStopCommand(ParseName(data),ParseCoordinates(data),ParseDistances(data));
+            } else if (action == Action::REPLACE) {
+                std::string_view name = ParseName(data);
+                updates.moved_stops.push_back({name,ParseCoordinates(data)});
+                // Без road_distances меняются только координаты
+                if (data.Has(Field::ROAD_DISTANCES)) {
+                    updates.replaced_distances.push_back(name);
+                    AddDistanceCommands(name,ParseDistances(data));
+                }
+            } else {
+                updates.removed_stops.push_back(ParseName(data));
+            }
+        } else if (type == RecordType::BUS){
+            if (action == Action::ADD) {
+                AddBusCommand(ParseName(data),ParseRoundtrip(data),ParseStops(data));
+            } else if (action == Action::REPLACE) {
+                updates.replaced_buses.push_back({ParseName(data),ParseRoundtrip(data),ParseStops(data)});
+            } else {
+                updates.removed_buses.push_back(ParseName(data));
+            }
+        } else if (type == RecordType::DISTANCE){
+            data.Require(Field::FROM);
+            data.Require(Field::TO);
+            std::string_view from = catalogue_->InternName(data.from);
+            std::string_view to = catalogue_->InternName(data.to);
+            if (action == Action::REMOVE) {
+                updates.removed_distances.push_back({from,to});
+            } else {
+                data.Require(Field::DISTANCE);
+                commands_ptr_->distances[std::make_pair(from,to)] = data.distance;
             }
         }
-        return *commands_ptr_;
     }
 
-    std::string JsonReader::ParseName(const json::Dict& request) const {
-        return request.at("name").AsString();
+    JsonReader::Action JsonReader::ParseAction(const BaseRecord& request) const {
+        if (!request.Has(Field::ACTION)) {
+            return Action::ADD;
+        }
+        const std::string_view action = request.action;
+        const size_t index = ACTIONS.Find(action);
+        if (index == ACTIONS.NOT_FOUND) {
+            throw std::invalid_argument("Unknown base request action: " + std::string(action));
+        }
+        return static_cast<Action>(index);
     }
 
-    geo::Coordinates JsonReader::ParseCoordinates(const json::Dict& request) const {
+    std::string_view JsonReader::ParseName(const BaseRecord& request) const {
+        request.Require(Field::NAME);
+        return catalogue_->InternName(request.name);
+    }
+
+    geo::Coordinates JsonReader::ParseCoordinates(const BaseRecord& request) const {
+        request.Require(Field::LATITUDE);
+        request.Require(Field::LONGITUDE);
+        return request.coordinates;
+    }
+
+    geo::Coordinates JsonReader::ParseCoordinates(const json::arena::Dict& request) const {
         geo::Coordinates location;
         location.lat = request.at("latitude").AsDouble();
         location.lng = request.at("longitude").AsDouble();
         return location;
     }
 
-    std::vector<std::pair<std::string,double>> JsonReader::ParseDistances(const json::Dict& request) const {
-        std::vector<std::pair<std::string,double>> distances;
-        for (auto [stop,dist] : request.at("road_distances").AsMap()){
-            distances.push_back(std::make_pair(stop,dist.AsDouble()));
-        }
-        return distances;
+    const std::vector<std::pair<std::string_view,double>>& JsonReader::ParseDistances(const BaseRecord& request) const {
+        request.Require(Field::ROAD_DISTANCES);
+        return request.road_distances;
     }
 
-    std::vector<std::string> JsonReader::ParseStops(const json::Dict& request) const{
-        std::vector<std::string> stops;
-        for (auto stop : request.at("stops").AsArray()){
-            stops.push_back(stop.AsString());
-        }
-        return stops;
+    std::vector<std::string_view> JsonReader::ParseStops(const BaseRecord& request) const{
+        request.Require(Field::STOPS);
+        return request.stops;
     }
 
-    bool JsonReader::ParseRoundtrip(const json::Dict& request) const{
-        return request.at("is_roundtrip").AsBool();
+    bool JsonReader::ParseRoundtrip(const BaseRecord& request) const{
+        request.Require(Field::IS_ROUNDTRIP);
+        return request.is_roundtrip;
     }
 
-    renderer::Settings JsonReader::ParseMapSettings(const json::Dict& request) const {
+    renderer::Settings JsonReader::ParseMapSettings(const json::arena::Dict& request) const {
         renderer::Settings output;
 
         output.width = request.at("width").AsDouble();
@@ -120,7 +730,7 @@ namespace json_reader {
         return output;
     }
 
-    svg::Color JsonReader::ParseColor(const json::Node& color_node) const {
+    svg::Color JsonReader::ParseColor(const json::arena::Node& color_node) const {
         svg::Color output;
         if (color_node.IsArray()) {
             if (color_node.AsArray().size() == 3){
@@ -138,122 +748,198 @@ namespace json_reader {
                 output = rgba;
             }
         } else {
-            output = color_node.AsString();
+            output = std::string(color_node.AsString());
         }
         return output;
     }
 
-    void JsonReader::AddStopCommand(const std::string& name, 
+    void JsonReader::AddStopCommand(std::string_view name, 
                         const geo::Coordinates& coordinates, 
-                        const std::vector<std::pair<std::string,double>>& distances) {
+                        const std::vector<std::pair<std::string_view,double>>& distances) {
         
         commands_ptr_->stop_commands.push_back({name,coordinates});
+        AddDistanceCommands(name,distances);
+    }
+
+    void JsonReader::AddDistanceCommands(std::string_view name, 
+                        const std::vector<std::pair<std::string_view,double>>& distances) {
         for (const auto&[name2,distance] : distances){
             commands_ptr_->distances[std::make_pair(name,name2)] = distance;
         }
     }
 
-    void JsonReader::AddBusCommand(const std::string& name, bool is_roundtrip, const std::vector<std::string>& stops){
-        commands_ptr_->bus_commands.push_back({name,is_roundtrip,stops});
+    void JsonReader::AddBusCommand(std::string_view name, bool is_roundtrip, std::vector<std::string_view>&& stops){
+        commands_ptr_->bus_commands.push_back({name,is_roundtrip,std::move(stops)});
     }
 
     void JsonReader::AddRequest(domain::request::Command request) {
         commands_ptr_->requests.push_back(request);
     } 
 
-    domain::router_data::Settings JsonReader::ParseRouteSettings(const json::Dict& request) const {
+    domain::router_data::Settings JsonReader::ParseRouteSettings(const json::arena::Dict& request) const {
         domain::router_data::Settings output;
         output.bus_wait_time = request.at("bus_wait_time").AsInt();
         output.velocity = request.at("bus_velocity").AsDouble();
+        if (request.count("huge_pages")) {
+            const std::string_view pages = request.at("huge_pages").AsString();
+            if (pages == "transparent") {
+                output.route_table_policy = memory::PagePolicy::TRANSPARENT_HUGE_PAGES;
+            } else if (pages == "explicit") {
+                output.route_table_policy = memory::PagePolicy::EXPLICIT_HUGE_PAGES;
+            } else {
+                throw std::invalid_argument("Unknown huge_pages value: " + std::string(pages));
+            }
+        }
         return output;
     }
 
 // ---------- JSON Printing ----------
 
-    json::Document JsonReader::PrintJson(std::ostream& output, const std::vector<domain::request::Response>& requests) const {
-        json::Array response_arr;
-        for (auto response : requests){
-            json::Builder dict_builder;
-            //response_dict["request_id"] = json::Node(response.id);
-            dict_builder.StartDict().Key("request_id").Value(response.id);
-            if (response.stop_data == nullptr && response.bus_data == nullptr && response.type != domain::request::Type::MAP){
-                //response_dict["error_message"] = json::Node(std::string("not found"));
-                dict_builder.Key("error_message").Value(std::string("not found"));
-            } else if (response.type == domain::request::Type::STOP){
-                PrintStop(dict_builder, response.stop_data);
-            } else if (response.type == domain::request::Type::BUS){
-                PrintBus(dict_builder,response.bus_data);
-            } else if (response.type == domain::request::Type::MAP){
-                PrintMap(dict_builder);
-            } else if (response.type == domain::request::Type::ROUTE){
-                PrintRoute(dict_builder, response.stop_data, response.stop_to);
-            }
-            response_arr.push_back(dict_builder.EndDict().Build().AsMap());
-
+    void JsonReader::PrintJson(json::Sink& output, const std::vector<domain::request::Response>& requests) const {
+        // Ответы печатаются порциями: ответы порции параллельно записываются каждый
+        // в свою строку и затем выводятся по порядку, так что память не зависит от числа
+        // ответов. Строки переиспользуются от порции к порции. Карта печатается сразу
+        // в приёмник, чтобы не копировать её текст
+        std::vector<std::string> texts(std::min(requests.size(), PRINT_BATCH_SIZE));
+        json::Writer writer(output, 0, print_options_);
+        writer.StartArray();
+        for (size_t batch = 0; batch < requests.size(); batch += PRINT_BATCH_SIZE) {
+            const size_t size = std::min(PRINT_BATCH_SIZE, requests.size() - batch);
+            parallel::ForRanges(size, thread_count_, [this, &requests, &texts, batch](size_t begin, size_t end){
+                for (size_t i = begin; i < end; ++i){
+                    if (requests[batch + i].type == domain::request::Type::MAP) {
+                        continue;
+                    }
+                    texts[i].clear();
+                    json::StringSink text(texts[i]);
+                    json::Writer item(text, 1, print_options_);
+                    PrintResponse(item, requests[batch + i]);
+                }
+            });
+            for (size_t i = 0; i < size; ++i) {
+                if (requests[batch + i].type == domain::request::Type::MAP) {
+                    PrintResponse(writer, requests[batch + i]);
+                } else {
+                    writer.RawValue(texts[i]);
+                }
+            }
         }
-        json::Builder builder;
-        builder.Value(response_arr);
-        json::Print(json::Document(builder.Build()),output);
-        return json::Document(builder.Build());
+        writer.EndArray();
     }
 
-    void JsonReader::PrintStop(json::Builder& builder, domain::Stop* stop) const{
-        /*json::Array buses;
-        for (auto bus : stop->buses){
-            buses.push_back(json::Node(std::string(bus)));
+    // Ключи ответа выводятся по алфавиту
+    void JsonReader::PrintResponse(json::Writer& writer, const domain::request::Response& response) const {
+        writer.StartDict();
+        if (response.stop_data == nullptr && response.bus_data == nullptr
+            && (response.type == domain::request::Type::STOP
+                || response.type == domain::request::Type::BUS
+                || response.type == domain::request::Type::ROUTE)){
+            PrintNotFound(writer, response.id);
+        } else if (response.type == domain::request::Type::STOP){
+            PrintStop(writer, response.id, response.stop_data);
+        } else if (response.type == domain::request::Type::BUS){
+            PrintBus(writer, response.id, response.bus_data);
+        } else if (response.type == domain::request::Type::MAP){
+            PrintMap(writer, response.id);
+        } else if (response.type == domain::request::Type::ROUTE){
+            PrintRoute(writer, response.id, response.stop_data, response.stop_to);
+        } else if (response.type == domain::request::Type::NEAREST_STOPS){
+            PrintNearestStops(writer, response);
+        } else if (response.type == domain::request::Type::STOPS_IN_BOX
+                   || response.type == domain::request::Type::STOP_SEARCH){
+            PrintStopNames(writer, response);
+        } else {
+            writer.Key("request_id").Value(response.id);
         }
-        response_dict["buses"] = json::Node(buses);*/
-        builder.Key("buses").StartArray();
-        for (auto bus : stop->buses){
-            builder.Value((std::string(bus)));
+        writer.EndDict();
+    }
+
+    void JsonReader::PrintNotFound(json::Writer& writer, int id) const {
+        writer
+            .Key("error_message")   .Value("not found")
+            .Key("request_id")      .Value(id);
+    }
+
+    void JsonReader::PrintStop(json::Writer& writer, int id, domain::Stop* stop) const{
+        writer.Key("buses").StartArray();
+        for (const domain::Bus* bus : catalogue_->GetStopBuses(stop)){
+            writer.Value(bus->name);
         }
-        builder.EndArray();
-    }
-    void JsonReader::PrintBus(json::Builder& builder, domain::Bus* bus) const{
-        /*
-        response_dict["curvature"] = json::Node(bus->curvature);
-        response_dict["route_length"] = json::Node(bus->length);
-        response_dict["stop_count"] = json::Node(bus->stops_count);
-        response_dict["unique_stop_count"] = json::Node(bus->unique_stops);
-        */
-        builder
+        writer.EndArray();
+        writer.Key("request_id").Value(id);
+    }
+
+    void JsonReader::PrintBus(json::Writer& writer, int id, domain::Bus* bus) const{
+        writer
             .Key("curvature")           .Value(bus->curvature)
+            .Key("request_id")          .Value(id)
             .Key("route_length")        .Value(bus->length)
             .Key("stop_count")          .Value(bus->stops_count)
             .Key("unique_stop_count")   .Value(bus->unique_stops);
-
     }
-    void JsonReader::PrintMap(json::Builder& builder) const {
-        std::ostringstream output;
-        map_renderer_->RenderMap(output);
-        builder.Key("map").Value(output.str());
-        //response_dict["map"] = json::Node(output.str());
+
+    void JsonReader::PrintMap(json::Writer& writer, int id) const {
+        writer.Key("map");
+        if (map_renderer_->IsPrerendered()) {
+            writer.Value(map_renderer_->GetRenderedMap());
+        } else {
+            std::ostringstream output;
+            map_renderer_->RenderMap(output);
+            writer.Value(output.str());
+        }
+        writer.Key("request_id").Value(id);
     }
-    
-    void JsonReader::PrintRoute(json::Builder& builder, domain::Stop* stop_from, domain::Stop* stop_to) const {
+
+    void JsonReader::PrintRoute(json::Writer& writer, int id, domain::Stop* stop_from, domain::Stop* stop_to) const {
         auto response = router_->GetRoute(stop_from,stop_to);
         if (!response.has_value()){
-            builder.Key("error_message").Value(std::string("not found"));
+            PrintNotFound(writer, id);
             return;
         }
-        builder
-            .Key("total_time")  .Value(response.value().total_time)
-            .Key("items")       .StartArray();
-        for (auto item : response.value().items){
-            builder.StartDict().Key("time").Value(item.time);
+        writer.Key("items").StartArray();
+        for (const auto& item : response.value().items){
+            writer.StartDict();
             if (item.type == domain::router_data::EdgeType::WAIT){
-                builder
-                    .Key("type")        .Value("Wait")
-                    .Key("stop_name")   .Value(item.name);
+                writer
+                    .Key("stop_name")   .Value(item.name)
+                    .Key("time")        .Value(item.time)
+                    .Key("type")        .Value("Wait");
             } else if (item.type == domain::router_data::EdgeType::BUS){
-                builder
-                    .Key("type")        .Value("Bus")
+                writer
                     .Key("bus")         .Value(item.name)
-                    .Key("span_count")  .Value(item.span_count.value());
+                    .Key("span_count")  .Value(item.span_count.value())
+                    .Key("time")        .Value(item.time)
+                    .Key("type")        .Value("Bus");
+            } else {
+                writer.Key("time").Value(item.time);
             }
-            builder.EndDict();
+            writer.EndDict();
+        }
+        writer.EndArray();
+        writer
+            .Key("request_id")  .Value(id)
+            .Key("total_time")  .Value(response.value().total_time);
+    }
+
+    void JsonReader::PrintNearestStops(json::Writer& writer, const domain::request::Response& response) const {
+        writer.Key("request_id").Value(response.id);
+        writer.Key("stops").StartArray();
+        for (const domain::Stop* stop : response.stops){
+            writer.StartDict()
+                .Key("distance")    .Value(geo::ComputeDistance(response.point,stop->coordinates))
+                .Key("name")        .Value(stop->name)
+            .EndDict();
+        }
+        writer.EndArray();
+    }
+
+    void JsonReader::PrintStopNames(json::Writer& writer, const domain::request::Response& response) const {
+        writer.Key("request_id").Value(response.id);
+        writer.Key("stops").StartArray();
+        for (const domain::Stop* stop : response.stops){
+            writer.Value(stop->name);
         }
-        builder.EndArray();
+        writer.EndArray();
     }
 
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #pragma once
-#include "json_builder.h"
+#include "json_arena.h"
+#include "json.h"
 #include "transport_catalogue.h"
 #include "map_renderer.h"
 #include "transport_router.h"
@@ -13,34 +14,77 @@ class JsonReader {
         void SetRenderer(renderer::MapRenderer& map_renderer_);
         void SetRouter(transport_router::TransportRouter& router);
         void SetCatalogue(transport::Catalogue& catalogue);
+        void SetThreadCount(size_t thread_count);
+
+        // При включённом учёте ParseJson запоминает оценку памяти прочитанного документа
+        void SetMemoryAccounting(bool enabled);
+        const memory::Report& GetDocumentMemoryUsage() const;
+
+        // Расположение и формат чисел ответов, по умолчанию - как у json::Print
+        void SetPrintOptions(const json::PrintOptions& options);
 
         domain::ParsedInput ParseJson (std::istream& input);
-        json::Document PrintJson (std::ostream& output, const std::vector<domain::request::Response>& requests) const;
+        void PrintJson (json::Sink& output, const std::vector<domain::request::Response>& requests) const;
     private:
         renderer::MapRenderer* map_renderer_ = nullptr;
         transport_router::TransportRouter* router_ = nullptr;
         transport::Catalogue* catalogue_;
         domain::ParsedInput* commands_ptr_;
+        size_t thread_count_ = 1;
+        bool memory_accounting_ = false;
+        json::PrintOptions print_options_;
+        memory::Report document_memory_;
+
+        // Действие записи base_requests (ключ "action"), по умолчанию - добавление
+        enum class Action {
+            ADD,
+            REPLACE,
+            REMOVE
+        };
+
+        // Записи base_requests превращаются в команды прямо из событий разбора,
+        // без построения дерева; остальные разделы документа собираются в дерево
+        class InputHandler;
+        struct BaseRecord;
+        struct BaseChunk;
 
-        void AddStopCommand(const std::string& name, 
+        // Длина куска base_requests, который разбирается одним потоком
+        static constexpr size_t PARSE_PART_SIZE = 1 << 20;
+
+        // Параллельный разбор кусков base_requests из json::SplitRootArray
+        void ParseBaseRequests(const std::vector<std::string_view>& parts, std::string_view text);
+        void ApplyBaseChunk(BaseChunk& chunk);
+        void ParseBaseRequest(const BaseRecord& request);
+        Action ParseAction(const BaseRecord& request) const;
+
+        void AddStopCommand(std::string_view name, 
                     const geo::Coordinates& coordinates_, 
-                    const std::vector<std::pair<std::string,double>>& distances);
-        void AddBusCommand(const std::string& name, bool is_roundtrip, const std::vector<std::string>& stops);
+                    const std::vector<std::pair<std::string_view,double>>& distances);
+        void AddDistanceCommands(std::string_view name, const std::vector<std::pair<std::string_view,double>>& distances);
+        void AddBusCommand(std::string_view name, bool is_roundtrip, std::vector<std::string_view>&& stops);
 		void AddRequest (domain::request::Command);
 
-        std::string ParseName(const json::Dict& request) const;
-        geo::Coordinates ParseCoordinates(const json::Dict& request) const;
-        std::vector<std::pair<std::string,double>> ParseDistances(const json::Dict& request) const;
-        std::vector<std::string> ParseStops(const json::Dict& request) const;
-        bool ParseRoundtrip(const json::Dict& request) const;
-        renderer::Settings ParseMapSettings(const json::Dict& request) const;
-        svg::Color ParseColor(const json::Node& color_node) const;
-        domain::router_data::Settings ParseRouteSettings(const json::Dict& request) const;
-
-        void PrintStop(json::Builder& builder, domain::Stop* stop) const;
-        void PrintBus(json::Builder& builder, domain::Bus* bus) const;
-        void PrintMap(json::Builder& builder) const;
-        void PrintRoute(json::Builder& builder, domain::Stop* stop_from, domain::Stop* stop_to) const;
+        std::string_view ParseName(const BaseRecord& request) const;
+        geo::Coordinates ParseCoordinates(const BaseRecord& request) const;
+        geo::Coordinates ParseCoordinates(const json::arena::Dict& request) const;
+        const std::vector<std::pair<std::string_view,double>>& ParseDistances(const BaseRecord& request) const;
+        std::vector<std::string_view> ParseStops(const BaseRecord& request) const;
+        bool ParseRoundtrip(const BaseRecord& request) const;
+        renderer::Settings ParseMapSettings(const json::arena::Dict& request) const;
+        svg::Color ParseColor(const json::arena::Node& color_node) const;
+        domain::router_data::Settings ParseRouteSettings(const json::arena::Dict& request) const;
+
+        // Число ответов, которые готовятся параллельно перед выводом
+        static constexpr size_t PRINT_BATCH_SIZE = 1024;
+
+        void PrintResponse(json::Writer& writer, const domain::request::Response& response) const;
+        void PrintNotFound(json::Writer& writer, int id) const;
+        void PrintStop(json::Writer& writer, int id, domain::Stop* stop) const;
+        void PrintBus(json::Writer& writer, int id, domain::Bus* bus) const;
+        void PrintMap(json::Writer& writer, int id) const;
+        void PrintRoute(json::Writer& writer, int id, domain::Stop* stop_from, domain::Stop* stop_to) const;
+        void PrintNearestStops(json::Writer& writer, const domain::request::Response& response) const;
+        void PrintStopNames(json::Writer& writer, const domain::request::Response& response) const;
 };
 
 }
\ No newline at end of file
@@ -1,13 +1,71 @@
 #include "request_handler.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
 #include <iostream>
+#include <string_view>
+#include <thread>
 
+#include <unistd.h>
 
-int main() {
+using namespace std::literals;
+
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue [make_base|process_requests|update_base]\n"sv;
+}
+
+int main(int argc, char* argv[]) {
+    // Без аргументов база строится и запросы обрабатываются за один запуск
+    const std::string_view mode = argc > 1 ? std::string_view(argv[1]) : ""sv;
+    if (argc > 2 || (argc == 2 && mode != "make_base"sv && mode != "process_requests"sv
+                                && mode != "update_base"sv)) {
+        PrintUsage();
+        return 1;
+    }
 
     transport::Catalogue catalogue;
     request::Handler handler(catalogue);
 
+    // TRANSPORT_CATALOGUE_MEMORY_REPORT=1 печатает в stderr расход памяти по структурам после загрузки
+    const char* memory_report = std::getenv("TRANSPORT_CATALOGUE_MEMORY_REPORT");
+    const bool print_memory = memory_report != nullptr && memory_report != "0"sv;
+    // TRANSPORT_CATALOGUE_COMPACT_JSON=1 печатает ответы без переводов строк и отступов
+    const char* compact_json = std::getenv("TRANSPORT_CATALOGUE_COMPACT_JSON");
+    // TRANSPORT_CATALOGUE_THREADS=N задаёт число рабочих потоков, по умолчанию - по числу ядер
+    const char* threads = std::getenv("TRANSPORT_CATALOGUE_THREADS");
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    if (threads != nullptr && *threads != '\0') {
+        const std::string_view value(threads);
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), thread_count);
+        if (error != std::errc() || end != value.data() + value.size() || thread_count == 0) {
+            std::cerr << "TRANSPORT_CATALOGUE_THREADS must be a positive integer\n"sv;
+            return 1;
+        }
+    }
+
+    handler.SetThreadCount(thread_count);
+    if (print_memory) {
+        handler.EnableMemoryReport();
+    }
+    handler.SetCompactOutput(compact_json != nullptr && compact_json != "0"sv);
     handler.ReadJson(std::cin);
-    handler.FillCatalogue();
-    handler.PrintJson(std::cout);
-}
\ No newline at end of file
+
+    if (mode == "make_base"sv) {
+        handler.MakeBase();
+    } else if (mode == "process_requests"sv) {
+        handler.LoadBase();
+    } else if (mode == "update_base"sv) {
+        handler.UpdateBase();
+    } else {
+        handler.FillCatalogue();
+    }
+    if (print_memory) {
+        handler.PrintMemoryReport(std::cerr);
+    }
+    if (mode != "make_base"sv && mode != "update_base"sv) {
+        // Ответы пишутся в stdout крупными блоками, минуя буфер std::cout
+        json::FdSink output(STDOUT_FILENO);
+        handler.PrintJson(output);
+        output.Flush();
+    }
+}
@@ -4,19 +4,50 @@ namespace renderer {
     
     void MapRenderer::SetSettings(Settings&& settings) {
         settings_ = std::move(settings);
+        rendered_map_.reset();
     }
 
-    void MapRenderer::SetCatalogue(transport::Catalogue& catalogue) {
+    const Settings& MapRenderer::GetSettings() const {
+        return settings_;
+    }
+
+    void MapRenderer::SetCatalogue(const transport::Catalogue& catalogue) {
         catalogue_ = &catalogue;
+        rendered_map_.reset();
     }
 
     void MapRenderer::RenderMap(std::ostream& output) const {
+        if (rendered_map_.has_value()) {
+            output << *rendered_map_;
+            return;
+        }
+        Render(output);
+    }
+
+    void MapRenderer::Prerender() {
+        if (rendered_map_.has_value()) {
+            return;
+        }
+        std::ostringstream output;
+        Render(output);
+        rendered_map_ = output.str();
+    }
+
+    bool MapRenderer::IsPrerendered() const {
+        return rendered_map_.has_value();
+    }
+
+    std::string_view MapRenderer::GetRenderedMap() const {
+        return *rendered_map_;
+    }
+
+    void MapRenderer::Render(std::ostream& output) const {
         std::vector<geo::Coordinates> all_coordinates;
-        for (auto stop : catalogue_->GetAllStops()){
-            if (stop->buses.empty()){
+        for (uint32_t id = 0; id < catalogue_->GetStopCount(); ++id){
+            if (!catalogue_->HasBuses(id)){
                 continue;
             }
-            all_coordinates.push_back(stop->coordinates);
+            all_coordinates.push_back(catalogue_->GetStopCoordinates(id));
         }
         SphereProjector project (all_coordinates.begin(),all_coordinates.end(),
             settings_.width,settings_.height,settings_.padding);
@@ -45,14 +76,14 @@ namespace renderer {
         }
 
         for(auto stop : catalogue_->GetAllStops()){
-            if (stop->buses.empty()){
+            if (!catalogue_->HasBuses(stop)){
                 continue;
             }
             output_document.Add(RenderStop(stop,project));
         }
 
         for(auto stop : catalogue_->GetAllStops()){
-            if (stop->buses.empty()){
+            if (!catalogue_->HasBuses(stop)){
                 continue;
             }
             RenderStopText(stop,project).AddToDocument(output_document);
@@ -69,8 +100,8 @@ namespace renderer {
             .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
             .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
 
-        for (auto stop : bus->stops){
-            svg::Point p = project(stop->coordinates);
+        for (uint32_t stop_id : catalogue_->GetBusStopIds(bus)){
+            svg::Point p = project(catalogue_->GetStopCoordinates(stop_id));
             bus_line.AddPoint(std::move(p));
         }
         return bus_line;
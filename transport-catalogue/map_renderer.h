@@ -2,6 +2,10 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
 
 #include "svg.h"
 #include "transport_catalogue.h"
@@ -145,9 +149,9 @@ namespace renderer {
             }
         }
 
-        void SetText(const std::string& text) {
-            front_text.SetData(text);
-            underlayer.SetData(text);
+        void SetText(std::string_view text) {
+            front_text.SetData(std::string(text));
+            underlayer.SetData(std::string(text));
         }
 
         void SetPosition(svg::Point point){
@@ -187,7 +191,7 @@ namespace renderer {
                 end.underlayer.SetFontWeight("bold");
             }
         
-        void SetText(const std::string& text) {
+        void SetText(std::string_view text) {
             begin.SetText(text);
             end.SetText(text);
         }
@@ -211,25 +215,41 @@ namespace renderer {
         bool is_roundtrip = false;
     };
 
-    // Отрисовщик схемы маршрутов
+    // Отрисовщик схемы маршрутов.
+    // RenderMap только читает настройки и каталог, поэтому после загрузки его можно
+    // вызывать из нескольких потоков
     class MapRenderer {
         public:
-            MapRenderer(transport::Catalogue& catalogue)
+            MapRenderer(const transport::Catalogue& catalogue)
                 : catalogue_(&catalogue){}
             
-            MapRenderer(Settings&& settings, transport::Catalogue& catalogue)
+            MapRenderer(Settings&& settings, const transport::Catalogue& catalogue)
                 : settings_(std::move(settings))
                 , catalogue_(&catalogue){}
             
-            void SetCatalogue(transport::Catalogue& catalogue);
+            void SetCatalogue(const transport::Catalogue& catalogue);
 
             void SetSettings(Settings&& settings);
+
+            const Settings& GetSettings() const;
             
             void RenderMap(std::ostream& output) const;
 
+            // Отрисовывает карту заранее, и RenderMap дальше только копирует готовый текст.
+            // SetCatalogue и SetSettings сбрасывают готовую карту
+            void Prerender();
+
+            bool IsPrerendered() const;
+
+            // Готовая карта; вызывается только после Prerender
+            std::string_view GetRenderedMap() const;
+
         private:
             Settings settings_;
-            transport::Catalogue* catalogue_;
+            const transport::Catalogue* catalogue_;
+            std::optional<std::string> rendered_map_;
+
+            void Render(std::ostream& output) const;
 
             svg::Polyline RenderBus(domain::Bus* bus, const SphereProjector& project) const;
             size_t NextColor(size_t prev) const;
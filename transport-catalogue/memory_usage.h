@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace memory {
+
+    // Оценка памяти одной структуры: bytes - сами данные, overhead - всё остальное,
+    // что держит контейнер (незанятая ёмкость, корзины и узлы хеш-таблиц, указатели деревьев).
+    // Заголовки блоков системного аллокатора не учитываются
+    struct Usage {
+        std::string component;
+        size_t bytes = 0;
+        size_t overhead = 0;
+    };
+
+    using Report = std::vector<Usage>;
+
+    template <typename T, typename Allocator>
+    Usage OfVector(std::string component, const std::vector<T, Allocator>& vector) {
+        return {std::move(component), vector.size() * sizeof(T),
+                (vector.capacity() - vector.size()) * sizeof(T)};
+    }
+
+    template <typename T>
+    Usage OfDeque(std::string component, const std::deque<T>& deque) {
+        // libstdc++ хранит элементы блоками по 512 байт (или по одному элементу, если он больше)
+        // и массив указателей на блоки
+        const size_t per_block = sizeof(T) < 512 ? 512 / sizeof(T) : 1;
+        const size_t blocks = deque.size() / per_block + 1;
+        return {std::move(component), deque.size() * sizeof(T),
+                blocks * (per_block * sizeof(T) + sizeof(void*)) - deque.size() * sizeof(T)};
+    }
+
+    template <typename HashContainer>
+    Usage OfHashContainer(std::string component, const HashContainer& container) {
+        // Узел хранит указатель на следующий узел и, как правило, закэшированный хеш
+        return {std::move(component), container.size() * sizeof(typename HashContainer::value_type),
+                container.bucket_count() * sizeof(void*) + container.size() * (sizeof(void*) + sizeof(size_t))};
+    }
+
+    inline void PrintReport(const Report& report, std::ostream& out) {
+        size_t total_bytes = 0;
+        size_t total_overhead = 0;
+        out << std::left << std::setw(40) << "component"
+            << std::right << std::setw(16) << "bytes" << std::setw(16) << "overhead" << '\n';
+        for (const Usage& usage : report) {
+            out << std::left << std::setw(40) << usage.component
+                << std::right << std::setw(16) << usage.bytes << std::setw(16) << usage.overhead << '\n';
+            total_bytes += usage.bytes;
+            total_overhead += usage.overhead;
+        }
+        out << std::left << std::setw(40) << "total"
+            << std::right << std::setw(16) << total_bytes << std::setw(16) << total_overhead << std::endl;
+    }
+
+}
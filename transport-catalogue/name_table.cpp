@@ -0,0 +1,51 @@
+#include "name_table.h"
+
+#include <cstring>
+
+namespace transport {
+
+    std::string_view NameTable::Intern(std::string_view name) {
+        if (auto it = names_.find(name); it != names_.end()) {
+            return *it;
+        }
+        char* data = Allocate(name.size());
+        std::memcpy(data, name.data(), name.size());
+        std::string_view stored(data, name.size());
+        names_.insert(stored);
+        return stored;
+    }
+
+    size_t NameTable::Size() const {
+        return names_.size();
+    }
+
+    memory::Report NameTable::GetMemoryUsage() const {
+        size_t used = 0;
+        for (std::string_view name : names_) {
+            used += name.size();
+        }
+        memory::Report report;
+        report.push_back(memory::OfHashContainer("names.index", names_));
+        report.push_back({"names.arena", used, arena_bytes_ - used + blocks_.capacity() * sizeof(void*)});
+        return report;
+    }
+
+    char* NameTable::Allocate(size_t size) {
+        if (size > BLOCK_SIZE / 4) {
+            // Длинные имена получают отдельный блок, чтобы не тратить остаток текущего
+            blocks_.push_back(std::make_unique<char[]>(size));
+            arena_bytes_ += size;
+            return blocks_.back().get();
+        }
+        if (current_block_ == nullptr || block_used_ + size > BLOCK_SIZE) {
+            blocks_.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            arena_bytes_ += BLOCK_SIZE;
+            current_block_ = blocks_.back().get();
+            block_used_ = 0;
+        }
+        char* data = current_block_ + block_used_;
+        block_used_ += size;
+        return data;
+    }
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "memory_usage.h"
+
+namespace transport {
+
+    // Хранилище уникальных имён остановок и маршрутов.
+    // Каждое имя хранится один раз в блоках непрерывной памяти, блоки никогда
+    // не перемещаются, поэтому выданные string_view действительны всё время жизни таблицы.
+    class NameTable {
+        public:
+            NameTable() = default;
+            NameTable(const NameTable&) = delete;
+            NameTable& operator=(const NameTable&) = delete;
+
+            std::string_view Intern(std::string_view name);
+
+            size_t Size() const;
+
+            memory::Report GetMemoryUsage() const;
+
+        private:
+            static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+            std::vector<std::unique_ptr<char[]>> blocks_;
+            char* current_block_ = nullptr;
+            size_t block_used_ = 0;
+            size_t arena_bytes_ = 0;
+            std::unordered_set<std::string_view> names_;
+
+            char* Allocate(size_t size);
+    };
+
+}
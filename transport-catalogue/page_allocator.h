@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace memory {
+
+    enum class PagePolicy {
+        DEFAULT,                // обычная куча
+        TRANSPARENT_HUGE_PAGES, // анонимный mmap + madvise(MADV_HUGEPAGE)
+        EXPLICIT_HUGE_PAGES     // mmap(MAP_HUGETLB), при нехватке страниц - как TRANSPARENT_HUGE_PAGES
+    };
+
+    inline constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    // Аллокатор для больших долгоживущих таблиц (например, таблицы маршрутов graph::Router).
+    // Память под huge pages выделяется целыми страницами по 2 МБ, поэтому аллокатор
+    // имеет смысл только для немногочисленных крупных блоков.
+    //
+    // Копий таблицы по узлам NUMA аллокатор не делает. Запросы отвечаются параллельно
+    // (parallel::ForRanges), но рабочие потоки создаются на каждый вызов и не привязаны
+    // к узлам, так что поток не знает, какая копия ему локальна. Копия таблицы V x V
+    // на каждый узел умножила бы самую крупную структуру процесса на число узлов, а
+    // привязка потоков и размещение страниц по узлам требуют libnuma, от которой
+    // проект не зависит. Страницы таблицы попадают на узел потока, заполнявшего её
+    // в конструкторе graph::Router.
+    template <typename T>
+    class PageAllocator {
+    public:
+        using value_type = T;
+
+        PageAllocator() = default;
+
+        explicit PageAllocator(PagePolicy policy)
+            : policy_(policy) {}
+
+        template <typename U>
+        PageAllocator(const PageAllocator<U>& other)
+            : policy_(other.GetPolicy()) {}
+
+        T* allocate(size_t n) {
+            if (policy_ == PagePolicy::DEFAULT) {
+                return std::allocator<T>().allocate(n);
+            }
+#ifdef __linux__
+            const size_t bytes = RoundToHugePage(n * sizeof(T));
+            void* ptr = MAP_FAILED;
+            if (policy_ == PagePolicy::EXPLICIT_HUGE_PAGES) {
+                ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            }
+            if (ptr == MAP_FAILED) {
+                ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (ptr == MAP_FAILED) {
+                    throw std::bad_alloc();
+                }
+                madvise(ptr, bytes, MADV_HUGEPAGE);
+            }
+            return static_cast<T*>(ptr);
+#else
+            return std::allocator<T>().allocate(n);
+#endif
+        }
+
+        void deallocate(T* ptr, size_t n) {
+            if (policy_ == PagePolicy::DEFAULT) {
+                std::allocator<T>().deallocate(ptr, n);
+                return;
+            }
+#ifdef __linux__
+            munmap(ptr, RoundToHugePage(n * sizeof(T)));
+#else
+            std::allocator<T>().deallocate(ptr, n);
+#endif
+        }
+
+        PagePolicy GetPolicy() const {
+            return policy_;
+        }
+
+        template <typename U>
+        bool operator==(const PageAllocator<U>& other) const {
+            return policy_ == other.GetPolicy();
+        }
+        template <typename U>
+        bool operator!=(const PageAllocator<U>& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        PagePolicy policy_ = PagePolicy::DEFAULT;
+
+        static size_t RoundToHugePage(size_t bytes) {
+            return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        }
+    };
+
+}  // namespace memory
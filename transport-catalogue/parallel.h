@@ -0,0 +1,32 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+    // Делит диапазон [0, count) на thread_count непрерывных частей и вызывает
+    // func(begin, end) для каждой части в отдельном потоке. Первая часть
+    // выполняется в вызывающем потоке. При thread_count <= 1 работает последовательно.
+    template <typename Func>
+    void ForRanges(size_t count, size_t thread_count, Func func) {
+        thread_count = std::max<size_t>(1, std::min(thread_count, count));
+        if (thread_count <= 1) {
+            func(size_t{0}, count);
+            return;
+        }
+        const size_t chunk = (count + thread_count - 1) / thread_count;
+        std::vector<std::thread> workers;
+        workers.reserve(thread_count - 1);
+        for (size_t begin = chunk; begin < count; begin += chunk) {
+            workers.emplace_back(func, begin, std::min(begin + chunk, count));
+        }
+        func(size_t{0}, std::min(chunk, count));
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "memory_usage.h"
+
+namespace perfect_hash {
+
+    inline void Prefetch(const void* address) {
+#if defined(__GNUC__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    // Минимальная совершенная хеш-таблица над неизменяемым набором строковых ключей
+    // (схема hash-and-displace). Строка хешируется один раз, дальше - только
+    // целочисленное перемешивание: bucket выбирает seed, seed - ячейку.
+    // После построения таблица только читается и может использоваться из нескольких потоков.
+    template <typename Value>
+    class Table {
+        public:
+            void Build(const std::vector<std::pair<std::string_view, Value>>& items) {
+                const size_t size = items.size();
+                keys_.assign(size, std::string_view());
+                values_.assign(size, Value{});
+                seeds_.assign(size / 4 + 1, 0);
+                if (size == 0) {
+                    return;
+                }
+
+                std::vector<std::vector<std::pair<uint64_t, size_t>>> buckets(seeds_.size());
+                for (size_t i = 0; i < size; ++i) {
+                    const uint64_t hash = Hash(items[i].first);
+                    buckets[hash % seeds_.size()].push_back({hash, i});
+                }
+                std::vector<size_t> order(buckets.size());
+                for (size_t i = 0; i < order.size(); ++i) {
+                    order[i] = i;
+                }
+                // Большие корзины размещаем первыми, пока свободных ячеек много
+                std::stable_sort(order.begin(), order.end(), [&buckets](size_t lhs, size_t rhs){
+                    return buckets[lhs].size() > buckets[rhs].size();
+                });
+
+                std::vector<bool> taken(size, false);
+                std::vector<size_t> slots;
+                for (size_t bucket : order) {
+                    if (buckets[bucket].empty()) {
+                        break;
+                    }
+                    for (uint32_t seed = 0;; ++seed) {
+                        if (seed == MAX_SEED) {
+                            throw std::logic_error("Failed to build perfect hash");
+                        }
+                        slots.clear();
+                        for (const auto& [hash, index] : buckets[bucket]) {
+                            const size_t slot = Slot(hash, seed);
+                            if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                                break;
+                            }
+                            slots.push_back(slot);
+                        }
+                        if (slots.size() == buckets[bucket].size()) {
+                            seeds_[bucket] = seed;
+                            for (size_t i = 0; i < slots.size(); ++i) {
+                                const size_t index = buckets[bucket][i].second;
+                                taken[slots[i]] = true;
+                                keys_[slots[i]] = items[index].first;
+                                values_[slots[i]] = items[index].second;
+                            }
+                            break;
+                        }
+                    }
+                }
+            }
+
+            std::optional<Value> Find(std::string_view key) const {
+                if (keys_.empty()) {
+                    return std::nullopt;
+                }
+                return FindHashed(key, Hash(key));
+            }
+
+            std::optional<Value> FindHashed(std::string_view key, uint64_t hash) const {
+                const size_t slot = Slot(hash, seeds_[hash % seeds_.size()]);
+                if (keys_[slot] != key) {
+                    return std::nullopt;
+                }
+                return values_[slot];
+            }
+
+            // Пакетный поиск: ключи группы сначала все хешируются, и для них запрашиваются
+            // seed, затем ячейки, затем байты ключей - промахи кэша разных ключей
+            // перекрываются. Для отсутствующих ключей в result записывается Value{}
+            void FindBatch(const std::string_view* keys, size_t count, Value* result) const {
+                if (keys_.empty()) {
+                    std::fill(result, result + count, Value{});
+                    return;
+                }
+                uint64_t hashes[BATCH_SIZE];
+                size_t slots[BATCH_SIZE];
+                for (size_t begin = 0; begin < count; begin += BATCH_SIZE) {
+                    const size_t size = std::min(BATCH_SIZE, count - begin);
+                    for (size_t i = 0; i < size; ++i) {
+                        hashes[i] = Hash(keys[begin + i]);
+                        Prefetch(&seeds_[hashes[i] % seeds_.size()]);
+                    }
+                    for (size_t i = 0; i < size; ++i) {
+                        slots[i] = Slot(hashes[i], seeds_[hashes[i] % seeds_.size()]);
+                        Prefetch(&keys_[slots[i]]);
+                        Prefetch(&values_[slots[i]]);
+                    }
+                    for (size_t i = 0; i < size; ++i) {
+                        Prefetch(keys_[slots[i]].data());
+                    }
+                    for (size_t i = 0; i < size; ++i) {
+                        result[begin + i] = keys_[slots[i]] == keys[begin + i] ? values_[slots[i]] : Value{};
+                    }
+                }
+            }
+
+            size_t Size() const {
+                return keys_.size();
+            }
+
+            memory::Usage GetMemoryUsage(std::string component) const {
+                return {std::move(component),
+                        keys_.capacity() * sizeof(std::string_view) + values_.capacity() * sizeof(Value),
+                        seeds_.capacity() * sizeof(uint32_t)};
+            }
+
+            static uint64_t Hash(std::string_view key) {
+                return std::hash<std::string_view>{}(key);
+            }
+
+        private:
+            static constexpr uint32_t MAX_SEED = 1u << 24;
+            static constexpr size_t BATCH_SIZE = 16;
+
+            std::vector<uint32_t> seeds_;
+            std::vector<std::string_view> keys_;
+            std::vector<Value> values_;
+
+            size_t Slot(uint64_t hash, uint32_t seed) const {
+                // splitmix64 от хеша, смещённого на seed
+                uint64_t x = hash + (static_cast<uint64_t>(seed) + 1) * 0x9E3779B97F4A7C15ull;
+                x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+                x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+                x ^= x >> 31;
+                return static_cast<size_t>(x % keys_.size());
+            }
+    };
+
+    constexpr size_t CeilPowerOfTwo(size_t value) {
+        size_t power = 1;
+        while (power < value) {
+            power *= 2;
+        }
+        return power;
+    }
+
+    // Совершенная хеш-таблица над ключами схемы, известными при компиляции, например
+    // ключами записей JSON. Хеш берёт только длину, первый и последний символ ключа,
+    // а seed подбирается в constexpr-конструкторе. Find делает одно вычисление хеша
+    // и одно сравнение строк: неизвестный ключ обычно отсекается уже по длине.
+    // Ключи должны различаться длиной, первым или последним символом, иначе таблица
+    // не строится, и объявление constexpr-таблицы не компилируется
+    template <size_t N>
+    class KeyTable {
+        public:
+            static_assert(N > 0 && N < 255);
+
+            // Номер, который Find возвращает для неизвестного ключа
+            static constexpr size_t NOT_FOUND = N;
+
+            constexpr explicit KeyTable(const std::string_view (&keys)[N]) {
+                for (size_t i = 0; i < N; ++i) {
+                    keys_[i] = keys[i];
+                }
+                for (uint32_t seed = 0; seed < MAX_SEED; ++seed) {
+                    if (TryBuild(seed)) {
+                        seed_ = seed;
+                        return;
+                    }
+                }
+                throw std::logic_error("Failed to build perfect hash");
+            }
+
+            // Номер ключа в массиве конструктора или NOT_FOUND
+            constexpr size_t Find(std::string_view key) const {
+                const size_t index = slots_[Slot(key, seed_)];
+                return index != N && keys_[index] == key ? index : N;
+            }
+
+        private:
+            static constexpr uint32_t MAX_SEED = 1u << 12;
+            // Ячеек вдвое больше ключей: seed находится за несколько попыток
+            static constexpr size_t SLOT_COUNT = CeilPowerOfTwo(2 * N);
+
+            std::array<std::string_view, N> keys_{};
+            std::array<uint8_t, SLOT_COUNT> slots_{};
+            uint32_t seed_ = 0;
+
+            static constexpr size_t Slot(std::string_view key, uint32_t seed) {
+                // splitmix64 от длины и крайних символов, смещённых на seed, как в Table
+                uint64_t x = static_cast<uint64_t>(key.size()) << 16;
+                if (!key.empty()) {
+                    x |= static_cast<uint64_t>(static_cast<unsigned char>(key.front())) << 8
+                         | static_cast<unsigned char>(key.back());
+                }
+                x += (static_cast<uint64_t>(seed) + 1) * 0x9E3779B97F4A7C15ull;
+                x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+                x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+                x ^= x >> 31;
+                return static_cast<size_t>(x & (SLOT_COUNT - 1));
+            }
+
+            constexpr bool TryBuild(uint32_t seed) {
+                for (uint8_t& slot : slots_) {
+                    slot = N;
+                }
+                for (size_t i = 0; i < N; ++i) {
+                    uint8_t& slot = slots_[Slot(keys_[i], seed)];
+                    if (slot != N) {
+                        return false;
+                    }
+                    slot = static_cast<uint8_t>(i);
+                }
+                return true;
+            }
+    };
+
+}
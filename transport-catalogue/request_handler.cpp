@@ -1,100 +1,370 @@
 #include "request_handler.h"
 
+#include "parallel.h"
+#include "serialization.h"
+
+#include <stdexcept>
 #include <unordered_set>
 
 
 namespace request {
 
+    using namespace std::literals;
+
     // ---------- Processor ---------
 
     void Handler::FillCatalogue(){
+        AddBaseRequests();
+        PrepareQueries();
+    }
+
+    void Handler::AddBaseRequests(){
+        if (!commands_.updates.Empty()) {
+            throw std::invalid_argument("replace and remove records need a loaded base");
+        }
         for (auto&& stop : commands_.stop_commands ) {
             catalogue_->AddStop(std::move(stop));
         }
         catalogue_->AddDistances(commands_.distances);
-        for (auto bus_command : commands_.bus_commands){
-            Bus new_bus;
-            new_bus.name = bus_command.name;
-            new_bus.is_roundtrip = bus_command.is_roundtrip;
-            std::unordered_set<Stop*> unique_stops;
-            if (!new_bus.is_roundtrip) {
-                std::vector<std::string> reverse = bus_command.stops;
-                for (int i = static_cast<int>(bus_command.stops.size()) - 2; i >= 0; i--) {
-                    reverse.push_back(bus_command.stops[static_cast<size_t>(i)]);
-                }
-                bus_command.stops = reverse;
+
+        // Параллельная часть: маршруты считаются независимо в заранее выделенные ячейки,
+        // каталог в это время только читается
+        std::vector<Bus> buses(commands_.bus_commands.size());
+        parallel::ForRanges(buses.size(), thread_count_, [this, &buses](size_t begin, size_t end){
+            for (size_t i = begin; i < end; ++i) {
+                buses[i] = ResolveBus(commands_.bus_commands[i]);
             }
-            std::string prev_stop = bus_command.stops.at(0);
-            bool first = true;
-            for(std::string stop : bus_command.stops) {
-                Stop* stop_ = catalogue_->GetStop(stop).value();
-                if (!first) {
-                    Stop* prev_ = catalogue_->GetStop(prev_stop).value();
-                    new_bus.geo_length += ComputeDistance(prev_->coordinates, stop_->coordinates);
-                    auto distance = catalogue_->GetDistance(prev_->name,stop_->name);
-                    if (distance.has_value()){
-                        new_bus.length += distance.value();
-                    }
-                }
-                new_bus.stops.push_back(catalogue_->GetStop(std::string(stop)).value());
-                unique_stops.insert(catalogue_->GetStop(std::string(stop)).value());
-                prev_stop = stop;
-                first = false;
+        });
+
+        // Одинаковые перегоны повторяются в обратной половине некольцевых маршрутов
+        // и на общих участках разных маршрутов - считаем каждый один раз
+        std::vector<std::pair<uint32_t,uint32_t>> geo_pairs;
+        for (const Bus& bus : buses) {
+            for (size_t i = 1; i < bus.stops.size(); ++i) {
+                geo_pairs.push_back({bus.stops[i - 1]->id, bus.stops[i]->id});
             }
-            
-            new_bus.unique_stops = static_cast<int>(unique_stops.size());
-            new_bus.curvature = new_bus.length/new_bus.geo_length;
-            new_bus.stops_count = static_cast<int>(new_bus.stops.size());
-            Bus* bus_pointer =catalogue_->AddBus(std::move(new_bus));
-            for (auto stop : unique_stops){
-                stop->buses.insert(bus_pointer->name);
+        }
+        catalogue_->CacheGeoDistances(geo_pairs, thread_count_);
+
+        parallel::ForRanges(buses.size(), thread_count_, [this, &buses](size_t begin, size_t end){
+            for (size_t i = begin; i < end; ++i) {
+                ComputeBusStatistics(buses[i]);
             }
+        });
+
+        // Последовательная часть: вставка в каталог в исходном порядке
+        for (Bus& bus : buses) {
+            catalogue_->AddBus(std::move(bus));
         }
+    }
+
+    Bus Handler::ResolveBus(const domain::command::BusDescription& bus_command) const {
+        Bus bus;
+        bus.name = bus_command.name;
+        bus.is_roundtrip = bus_command.is_roundtrip;
+        bus.stops.reserve(bus.is_roundtrip ? bus_command.stops.size() : bus_command.stops.size() * 2);
+        for (std::string_view stop : bus_command.stops) {
+            bus.stops.push_back(catalogue_->GetStop(stop).value());
+        }
+        if (!bus.is_roundtrip) {
+            for (int i = static_cast<int>(bus_command.stops.size()) - 2; i >= 0; i--) {
+                bus.stops.push_back(bus.stops[static_cast<size_t>(i)]);
+            }
+        }
+        return bus;
+    }
+
+    void Handler::ComputeBusStatistics(Bus& bus) const {
+        std::unordered_set<Stop*> unique_stops(bus.stops.begin(), bus.stops.end());
+        bus.geo_length = 0.0;
+        bus.length = 0.0;
+        for (size_t i = 1; i < bus.stops.size(); ++i) {
+            const uint32_t prev_id = bus.stops[i - 1]->id;
+            const uint32_t stop_id = bus.stops[i]->id;
+            bus.geo_length += catalogue_->GetGeoDistance(prev_id, stop_id);
+            bus.length += catalogue_->GetDistance(prev_id, stop_id).value_or(0.0);
+        }
+        bus.unique_stops = static_cast<int>(unique_stops.size());
+        bus.stops_count = static_cast<int>(bus.stops.size());
+        bus.curvature = bus.length/bus.geo_length;
+    }
+
+    void Handler::MakeBase() {
+        // Маршрутизатор и карта в файл не попадают, process_requests строит их сам
+        AddBaseRequests();
+        catalogue_->SortAll();
+        serialization::SaveBase(GetSerializationFile(), *catalogue_,
+                                renderer_->GetSettings(), router_->GetSettings());
+    }
+
+    void Handler::LoadBase() {
+        ReadBase();
+        PrepareQueries();
+    }
+
+    void Handler::UpdateBase() {
+        ReadBase();
         catalogue_->SortAll();
+        ApplyPatch();
+        catalogue_->SortAll();
+        serialization::SaveBase(GetSerializationFile(), *catalogue_,
+                                renderer_->GetSettings(), router_->GetSettings());
+    }
+
+    void Handler::ReadBase() {
+        renderer::Settings render_settings;
+        domain::router_data::Settings routing_settings;
+        serialization::LoadBase(GetSerializationFile(), *catalogue_, render_settings, routing_settings);
+        renderer_->SetSettings(std::move(render_settings));
+        router_->SetSettings(routing_settings);
+    }
+
+    void Handler::ApplyPatch() {
+        const domain::command::Updates& updates = commands_.updates;
+        catalogue_->Unfreeze();
+        // Существующие маршруты, у которых изменились координаты остановок или длины перегонов
+        std::vector<Bus*> affected;
+
+        // Остановки. Смежность остановка -> маршруты ещё в состоянии до изменений
+        for (auto&& stop : commands_.stop_commands) {
+            if (catalogue_->GetStop(stop.name).value() != nullptr) {
+                throw std::invalid_argument("Stop "s + std::string(stop.name) + " already exists"s);
+            }
+            catalogue_->AddStop(std::move(stop));
+        }
+        for (const Stop& stop : updates.moved_stops) {
+            Stop* old_stop = RequireStop(stop.name);
+            if (old_stop->coordinates.lat == stop.coordinates.lat
+                && old_stop->coordinates.lng == stop.coordinates.lng) {
+                continue;
+            }
+            catalogue_->MoveStop(old_stop, stop.coordinates);
+            for (Bus* bus : catalogue_->GetStopBuses(old_stop)) {
+                affected.push_back(bus);
+            }
+        }
+
+        // Замена road_distances остановки: старые расстояния от неё удаляются целиком.
+        // Через удалённое расстояние могли считаться оба направления любого её перегона
+        for (std::string_view name : updates.replaced_distances) {
+            Stop* stop = RequireStop(name);
+            catalogue_->RemoveDistancesFrom(stop->id);
+            for (Bus* bus : catalogue_->GetStopBuses(stop)) {
+                affected.push_back(bus);
+            }
+        }
+        // Расстояния влияют только на маршруты, у которых есть такой перегон
+        for (const auto& [stop_pair, distance] : commands_.distances) {
+            CollectSegmentBuses(RequireStop(stop_pair.first), RequireStop(stop_pair.second), affected);
+        }
+        catalogue_->AddDistances(commands_.distances);
+        for (const auto& [from, to] : updates.removed_distances) {
+            Stop* from_stop = RequireStop(from);
+            Stop* to_stop = RequireStop(to);
+            CollectSegmentBuses(from_stop, to_stop, affected);
+            catalogue_->RemoveDistance(from_stop->id, to_stop->id);
+        }
+
+        // Маршруты: замена - это удаление старого и добавление нового под тем же именем
+        std::vector<const domain::command::BusDescription*> new_buses;
+        for (std::string_view name : updates.removed_buses) {
+            catalogue_->RemoveBus(RequireBus(name));
+        }
+        for (const domain::command::BusDescription& bus : updates.replaced_buses) {
+            catalogue_->RemoveBus(RequireBus(bus.name));
+            new_buses.push_back(&bus);
+        }
+        for (const domain::command::BusDescription& bus : commands_.bus_commands) {
+            if (catalogue_->GetBus(bus.name).value() != nullptr) {
+                throw std::invalid_argument("Bus "s + std::string(bus.name) + " already exists"s);
+            }
+            new_buses.push_back(&bus);
+        }
+        std::vector<Bus> buses;
+        for (const domain::command::BusDescription* bus : new_buses) {
+            for (std::string_view stop : bus->stops) {
+                RequireStop(stop);
+            }
+            buses.push_back(ResolveBus(*bus));
+        }
+        // Удалённые и заменённые маршруты пересчитывать не нужно
+        std::sort(affected.begin(), affected.end());
+        affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+        affected.erase(std::remove_if(affected.begin(), affected.end(), [this](Bus* bus){
+            return catalogue_->GetBus(bus->name).value() != bus;
+        }), affected.end());
+
+        std::vector<std::pair<uint32_t,uint32_t>> geo_pairs;
+        auto add_geo_pairs = [&geo_pairs](const Bus& bus){
+            for (size_t i = 1; i < bus.stops.size(); ++i) {
+                geo_pairs.push_back({bus.stops[i - 1]->id, bus.stops[i]->id});
+            }
+        };
+        for (const Bus* bus : affected) {
+            add_geo_pairs(*bus);
+        }
+        for (const Bus& bus : buses) {
+            add_geo_pairs(bus);
+        }
+        catalogue_->CacheGeoDistances(geo_pairs, thread_count_);
+
+        for (Bus* bus : affected) {
+            ComputeBusStatistics(*bus);
+        }
+        for (Bus& bus : buses) {
+            ComputeBusStatistics(bus);
+            catalogue_->AddBus(std::move(bus));
+        }
+
+        // Остановки удаляются последними: к этому моменту маршруты через них уже убраны или заменены
+        for (std::string_view name : updates.removed_stops) {
+            catalogue_->RemoveStop(RequireStop(name));
+        }
+    }
+
+    Stop* Handler::RequireStop(std::string_view name) const {
+        Stop* stop = catalogue_->GetStop(name).value();
+        if (stop == nullptr) {
+            throw std::invalid_argument("Unknown stop "s + std::string(name));
+        }
+        return stop;
+    }
+
+    Bus* Handler::RequireBus(std::string_view name) const {
+        Bus* bus = catalogue_->GetBus(name).value();
+        if (bus == nullptr) {
+            throw std::invalid_argument("Unknown bus "s + std::string(name));
+        }
+        return bus;
+    }
+
+    void Handler::CollectSegmentBuses(const Stop* from, const Stop* to, std::vector<Bus*>& buses) const {
+        for (Bus* bus : catalogue_->GetStopBuses(from)) {
+            for (size_t i = 1; i < bus->stops.size(); ++i) {
+                if ((bus->stops[i - 1] == from && bus->stops[i] == to)
+                    || (bus->stops[i - 1] == to && bus->stops[i] == from)) {
+                    buses.push_back(bus);
+                    break;
+                }
+            }
+        }
+    }
+
+    const std::string& Handler::GetSerializationFile() const {
+        if (!commands_.serialization_file.has_value()) {
+            throw std::logic_error("serialization_settings are not set");
+        }
+        return commands_.serialization_file.value();
+    }
+
+    void Handler::PrepareQueries() {
+        catalogue_->SortAll();
+        catalogue_->Freeze();
         router_->LoadCatalogue();
+        // Карта одна на все запросы Map - рисуем её один раз
+        const bool has_map_requests = std::any_of(commands_.requests.begin(), commands_.requests.end(),
+            [](const domain::request::Command& request){
+                return request.type == domain::request::Type::MAP;
+            });
+        if (has_map_requests) {
+            renderer_->Prerender();
+        }
     }
 
     std::vector<domain::request::Response> Handler::GetRequests() const {
-        std::vector<domain::request::Response> output;
-        for (auto request : commands_.requests){
-            domain::request::Response response;
-            response.id = request.id;
+        std::vector<domain::request::Response> output(commands_.requests.size());
+        parallel::ForRanges(output.size(), thread_count_, [this, &output](size_t begin, size_t end){
+            ResolveNames(begin, end, output);
+            for (size_t i = begin; i < end; ++i) {
+                FillResponse(commands_.requests[i], output[i]);
+            }
+        });
+        return output;
+    }
+
+    void Handler::ResolveNames(size_t begin, size_t end, std::vector<domain::request::Response>& output) const {
+        // Имена всех запросов диапазона ищутся двумя пакетами - остановки и маршруты
+        std::vector<std::string_view> stop_names;
+        std::vector<std::string_view> bus_names;
+        for (size_t i = begin; i < end; ++i) {
+            const domain::request::Command& request = commands_.requests[i];
             if (request.type == domain::request::Type::STOP) {
-                auto stop = catalogue_->GetStop(request.name);
-                if (stop.has_value()){
-                    response.stop_data = stop.value();
-                    response.type = domain::request::Type::STOP;
-                }
-            } else if (request.type == domain::request::Type::BUS) {
-                auto bus = catalogue_->GetBus(request.name);
-                if (bus.has_value()){
-                    response.bus_data = bus.value();
-                    response.type = domain::request::Type::BUS;
-                }
-            } else if (request.type == domain::request::Type::MAP) {
-                response.type = domain::request::Type::MAP;
+                stop_names.push_back(request.name);
             } else if (request.type == domain::request::Type::ROUTE) {
-                auto stop = catalogue_->GetStop(request.name);
-                auto stop_to = catalogue_->GetStop(request.to_name.value());
-                if (stop.has_value() && stop_to.has_value()){
-                    response.type = domain::request::Type::ROUTE;
-                    response.stop_data = stop.value();
-                    response.stop_to = stop_to.value();
-                }
+                stop_names.push_back(request.name);
+                stop_names.push_back(request.to_name.value());
+            } else if (request.type == domain::request::Type::BUS) {
+                bus_names.push_back(request.name);
+            }
+        }
+        const std::vector<Stop*> stops = catalogue_->GetStops(stop_names);
+        const std::vector<Bus*> buses = catalogue_->GetBuses(bus_names);
+
+        auto next_stop = stops.begin();
+        auto next_bus = buses.begin();
+        for (size_t i = begin; i < end; ++i) {
+            const domain::request::Type type = commands_.requests[i].type;
+            if (type == domain::request::Type::STOP) {
+                output[i].stop_data = *next_stop++;
+            } else if (type == domain::request::Type::ROUTE) {
+                output[i].stop_data = *next_stop++;
+                output[i].stop_to = *next_stop++;
+            } else if (type == domain::request::Type::BUS) {
+                output[i].bus_data = *next_bus++;
             }
-            output.push_back(response);
         }
-        return output;
     }
 
+    void Handler::FillResponse(const domain::request::Command& request, domain::request::Response& response) const {
+        response.id = request.id;
+        response.type = request.type;
+        if (request.type == domain::request::Type::NEAREST_STOPS) {
+            response.point = request.point;
+            response.stops = catalogue_->GetNearestStops(request.point,
+                static_cast<size_t>(std::max(request.count,0)));
+        } else if (request.type == domain::request::Type::STOPS_IN_BOX) {
+            response.stops = catalogue_->GetStopsInBox(request.point,request.point_to);
+        } else if (request.type == domain::request::Type::STOP_SEARCH) {
+            response.stops = catalogue_->FindStopsByPrefix(request.name,
+                static_cast<size_t>(std::max(request.count,0)));
+        }
+    }
+
+
+    void Handler::SetThreadCount(size_t thread_count) {
+        thread_count_ = thread_count;
+        json_reader_->SetThreadCount(thread_count);
+    }
+
+    void Handler::SetCompactOutput(bool compact) {
+        json::PrintOptions options;
+        options.layout = compact ? json::Layout::COMPACT : json::Layout::PRETTY;
+        json_reader_->SetPrintOptions(options);
+    }
+
+    void Handler::EnableMemoryReport() {
+        json_reader_->SetMemoryAccounting(true);
+    }
+
+    void Handler::PrintMemoryReport(std::ostream& output) const {
+        memory::Report report = json_reader_->GetDocumentMemoryUsage();
+        for (memory::Report part : {catalogue_->GetMemoryUsage(), router_->GetMemoryUsage()}) {
+            report.insert(report.end(), part.begin(), part.end());
+        }
+        memory::PrintReport(report, output);
+    }
 
     void Handler::ReadJson(std::istream& input) {
         commands_= json_reader_->ParseJson(input);
     }
     void Handler::PrintJson(std::ostream& output) const{
+        json::StreamSink sink(output);
+        PrintJson(sink);
+        sink.Flush();
+    }
+    void Handler::PrintJson(json::Sink& output) const{
         std::vector<domain::request::Response> responses = GetRequests();
         json_reader_->PrintJson(output,responses);
-        
     }
     void Handler::RenderMap(std::ostream& output) const{
         renderer_->RenderMap(output);
@@ -6,48 +6,89 @@
 #include "map_renderer.h"
 #include "transport_router.h"
 
+#include <memory>
 
 namespace request {
 
 	using domain::Stop;
 	using domain::Bus;
-	using domain::StopPairHasher;
 	using domain::PairHasher;
     using domain::DistancesStringMap;
-    using domain::DistancesStopMap;
     using domain::ParsedInput;
     using transport::Catalogue;
     using json_reader::JsonReader;
     using renderer::MapRenderer;
     using transport_router::TransportRouter;
 
+    // После FillCatalogue каталог заморожен, а маршрутизатор и отрисовщик не изменяются:
+    // ответы на запросы вычисляются только через const-методы и могут строиться параллельно.
+    // UpdateBase размораживает каталог на время применения изменений
     class Handler {
     public:
         Handler(Catalogue& catalogue)
             : catalogue_(&catalogue)
-            , renderer_(new MapRenderer(catalogue))
-            , json_reader_(new JsonReader(catalogue)) 
-            , router_(new TransportRouter(catalogue)){
+            , renderer_(std::make_unique<MapRenderer>(catalogue))
+            , json_reader_(std::make_unique<JsonReader>(catalogue))
+            , router_(std::make_unique<TransportRouter>(catalogue)){
                 json_reader_->SetRenderer(*renderer_);
                 json_reader_->SetRouter(*router_);
             }
 
+        // Число потоков для подсчёта статистики маршрутов и обработки stat_requests, по умолчанию 1.
+        // Результат не зависит от числа потоков
+        void SetThreadCount(size_t thread_count);
+
+        // Ответы печатаются без переводов строк и отступов. По умолчанию - с отступами
+        void SetCompactOutput(bool compact);
+
         void ReadJson(std::istream& input);
         void PrintJson(std::ostream& output) const;
+        void PrintJson(json::Sink& output) const;
+
+        // Учёт памяти включается до ReadJson, отчёт печатается после загрузки
+        void EnableMemoryReport();
+        void PrintMemoryReport(std::ostream& output) const;
         void RenderMap(std::ostream& output) const;
         void GenerateOutput(std::ostream& json_output, std::ostream& svg_output) const;
 
         void FillCatalogue();  
 
+        // make_base: заполняет каталог из base_requests и сохраняет его в файл
+        // из serialization_settings. Маршрутизатор и карта не строятся
+        void MakeBase();
+
+        // process_requests: загружает каталог из файла serialization_settings
+        void LoadBase();
+
+        // update_base: загружает базу, применяет изменения и сохраняет её в тот же файл
+        void UpdateBase();
+
     private:
         Catalogue* catalogue_;
-        MapRenderer* renderer_;
-        JsonReader* json_reader_;
-        TransportRouter* router_;
+        std::unique_ptr<MapRenderer> renderer_;
+        std::unique_ptr<JsonReader> json_reader_;
+        std::unique_ptr<TransportRouter> router_;
         ParsedInput commands_;
+        size_t thread_count_ = 1;
     
         
+        const std::string& GetSerializationFile() const;
+        void ReadBase();
+        void AddBaseRequests();
+        void PrepareQueries();
+        // Применяет base_requests как изменения уже заполненного каталога: записи с "action"
+        // "add" (по умолчанию), "replace" или "remove" для Stop, Bus и Distance.
+        // Пересчитывается статистика только затронутых маршрутов
+        void ApplyPatch();
+        Stop* RequireStop(std::string_view name) const;
+        Bus* RequireBus(std::string_view name) const;
+        void CollectSegmentBuses(const Stop* from, const Stop* to, std::vector<Bus*>& buses) const;
+        Bus ResolveBus(const domain::command::BusDescription& bus_command) const;
+        void ComputeBusStatistics(Bus& bus) const;
+
         std::vector<domain::request::Response> GetRequests() const; 
+        void ResolveNames(size_t begin, size_t end, std::vector<domain::request::Response>& output) const;
+        void FillResponse(const domain::request::Command& request, domain::request::Response& response) const;
     };
 
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "graph.h"
+#include "memory_usage.h"
+#include "page_allocator.h"
 
 #include <algorithm>
 #include <cassert>
@@ -20,7 +22,8 @@ private:
     using Graph = DirectedWeightedGraph<Weight>;
 
 public:
-    explicit Router(const Graph& graph);
+    explicit Router(const Graph& graph,
+                    memory::PagePolicy table_policy = memory::PagePolicy::DEFAULT);
 
     struct RouteInfo {
         Weight weight;
@@ -29,23 +32,36 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    memory::Usage GetMemoryUsage() const {
+        return memory::OfVector("router.route_table", routes_internal_data_);
+    }
+
 private:
     struct RouteInternalData {
         Weight weight;
         std::optional<EdgeId> prev_edge;
     };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+    using RouteCell = std::optional<RouteInternalData>;
+    // Таблица V x V хранится одним непрерывным блоком, строка за строкой
+    using RoutesInternalData = std::vector<RouteCell, memory::PageAllocator<RouteCell>>;
+
+    RouteCell& Cell(VertexId from, VertexId to) {
+        return routes_internal_data_[from * vertex_count_ + to];
+    }
+    const RouteCell& Cell(VertexId from, VertexId to) const {
+        return routes_internal_data_[from * vertex_count_ + to];
+    }
 
     void InitializeRoutesInternalData(const Graph& graph) {
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+            Cell(vertex, vertex) = RouteInternalData{ZERO_WEIGHT, std::nullopt};
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
+                auto& route_internal_data = Cell(vertex, edge.to);
                 if (!route_internal_data || route_internal_data->weight > edge.weight) {
                     route_internal_data = RouteInternalData{edge.weight, edge_id};
                 }
@@ -55,7 +71,7 @@ private:
 
     void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
                     const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
+        auto& route_relaxing = Cell(vertex_from, vertex_to);
         const Weight candidate_weight = route_from.weight + route_to.weight;
         if (!route_relaxing || candidate_weight < route_relaxing->weight) {
             route_relaxing = {candidate_weight,
@@ -65,9 +81,9 @@ private:
 
     void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
         for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
+            if (const auto& route_from = Cell(vertex_from, vertex_through)) {
                 for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
+                    if (const auto& route_to = Cell(vertex_through, vertex_to)) {
                         RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
                     }
                 }
@@ -77,14 +93,16 @@ private:
 
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
+    const size_t vertex_count_;
     RoutesInternalData routes_internal_data_;
 };
 
 template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+Router<Weight>::Router(const Graph& graph, memory::PagePolicy table_policy)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , vertex_count_(graph.GetVertexCount())
+    , routes_internal_data_(vertex_count_ * vertex_count_,
+                            memory::PageAllocator<RouteCell>(table_policy))
 {
     InitializeRoutesInternalData(graph);
 
@@ -97,7 +115,10 @@ Router<Weight>::Router(const Graph& graph)
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const auto& route_internal_data = Cell(from, to);
     if (!route_internal_data) {
         return std::nullopt;
     }
@@ -105,7 +126,7 @@ std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(Ver
     std::vector<EdgeId> edges;
     for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
          edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+         edge_id = Cell(from, graph_.GetEdge(*edge_id).from)->prev_edge)
     {
         edges.push_back(*edge_id);
     }
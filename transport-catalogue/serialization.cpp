@@ -0,0 +1,399 @@
+#include "serialization.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace serialization {
+
+    using namespace std::literals;
+
+    namespace {
+
+        constexpr std::string_view MAGIC = "TCDB"sv;
+        constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+        constexpr uint32_t NO_STOP = ~uint32_t{0};
+
+// ---------- Writer ----------
+
+        class Writer {
+            public:
+                template <typename T>
+                void Write(T value) {
+                    static_assert(std::is_trivially_copyable_v<T>);
+                    buffer_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+                }
+
+                void WriteString(std::string_view str) {
+                    Write(static_cast<uint32_t>(str.size()));
+                    buffer_.append(str.data(), str.size());
+                }
+
+                void WriteRaw(std::string_view data) {
+                    buffer_.append(data.data(), data.size());
+                }
+
+                const std::string& GetBuffer() const {
+                    return buffer_;
+                }
+
+            private:
+                std::string buffer_;
+        };
+
+// ---------- Reader ----------
+
+        class Reader {
+            public:
+                Reader(const char* begin, const char* end)
+                    : pos_(begin)
+                    , end_(end) {}
+
+                template <typename T>
+                T Read() {
+                    static_assert(std::is_trivially_copyable_v<T>);
+                    Require(sizeof(T));
+                    T value;
+                    std::memcpy(&value, pos_, sizeof(T));
+                    pos_ += sizeof(T);
+                    return value;
+                }
+
+                std::string_view ReadString() {
+                    const uint32_t size = Read<uint32_t>();
+                    Require(size);
+                    std::string_view result(pos_, size);
+                    pos_ += size;
+                    return result;
+                }
+
+                // Сколько записей размера item_size ещё может уместиться в файле
+                size_t RemainingItems(size_t item_size) const {
+                    return static_cast<size_t>(end_ - pos_) / item_size;
+                }
+
+            private:
+                const char* pos_;
+                const char* end_;
+
+                void Require(size_t size) const {
+                    if (static_cast<size_t>(end_ - pos_) < size) {
+                        throw std::runtime_error("Unexpected end of base file");
+                    }
+                }
+        };
+
+// ---------- File access ----------
+
+        // Содержимое файла базы: отображение в память, а если оно недоступно - копия в строке
+        class FileData {
+            public:
+                explicit FileData(const std::string& path) {
+#ifdef __linux__
+                    const int fd = open(path.c_str(), O_RDONLY);
+                    if (fd >= 0) {
+                        struct stat info;
+                        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                            void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                            if (mapped != MAP_FAILED) {
+                                mapped_ = static_cast<const char*>(mapped);
+                                size_ = static_cast<size_t>(info.st_size);
+                            }
+                        }
+                        close(fd);
+                    }
+                    if (mapped_ != nullptr) {
+                        return;
+                    }
+#endif
+                    std::ifstream input(path, std::ios::binary);
+                    if (!input) {
+                        throw std::runtime_error("Can't open base file "s + path);
+                    }
+                    copy_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+                    size_ = copy_.size();
+                }
+
+                FileData(const FileData&) = delete;
+                FileData& operator=(const FileData&) = delete;
+
+                ~FileData() {
+#ifdef __linux__
+                    if (mapped_ != nullptr) {
+                        munmap(const_cast<char*>(mapped_), size_);
+                    }
+#endif
+                }
+
+                const char* begin() const {
+                    return mapped_ != nullptr ? mapped_ : copy_.data();
+                }
+
+                const char* end() const {
+                    return begin() + size_;
+                }
+
+            private:
+                const char* mapped_ = nullptr;
+                size_t size_ = 0;
+                std::string copy_;
+        };
+
+// ---------- Settings ----------
+
+        enum class ColorType : uint8_t {
+            NONE,
+            RGB,
+            RGBA,
+            STRING
+        };
+
+        void WriteColor(Writer& writer, const svg::Color& color) {
+            if (std::holds_alternative<svg::Rgb>(color)) {
+                const svg::Rgb& rgb = std::get<svg::Rgb>(color);
+                writer.Write(ColorType::RGB);
+                writer.Write(rgb.red);
+                writer.Write(rgb.green);
+                writer.Write(rgb.blue);
+            } else if (std::holds_alternative<svg::Rgba>(color)) {
+                const svg::Rgba& rgba = std::get<svg::Rgba>(color);
+                writer.Write(ColorType::RGBA);
+                writer.Write(rgba.red);
+                writer.Write(rgba.green);
+                writer.Write(rgba.blue);
+                writer.Write(rgba.opacity);
+            } else if (std::holds_alternative<std::string>(color)) {
+                writer.Write(ColorType::STRING);
+                writer.WriteString(std::get<std::string>(color));
+            } else {
+                writer.Write(ColorType::NONE);
+            }
+        }
+
+        svg::Color ReadColor(Reader& reader) {
+            switch (reader.Read<ColorType>()) {
+                case ColorType::RGB: {
+                    svg::Rgb rgb;
+                    rgb.red = reader.Read<uint8_t>();
+                    rgb.green = reader.Read<uint8_t>();
+                    rgb.blue = reader.Read<uint8_t>();
+                    return rgb;
+                }
+                case ColorType::RGBA: {
+                    svg::Rgba rgba;
+                    rgba.red = reader.Read<uint8_t>();
+                    rgba.green = reader.Read<uint8_t>();
+                    rgba.blue = reader.Read<uint8_t>();
+                    rgba.opacity = reader.Read<double>();
+                    return rgba;
+                }
+                case ColorType::STRING:
+                    return std::string(reader.ReadString());
+                case ColorType::NONE:
+                    return std::monostate{};
+            }
+            throw std::runtime_error("Unknown color type in base file");
+        }
+
+        void WriteRenderSettings(Writer& writer, const renderer::Settings& settings) {
+            writer.Write(settings.width);
+            writer.Write(settings.height);
+            writer.Write(settings.padding);
+            writer.Write(settings.line_width);
+            writer.Write(settings.stop_radius);
+            writer.Write(settings.bus_label_font_size);
+            writer.Write(settings.bus_label_offset.x);
+            writer.Write(settings.bus_label_offset.y);
+            writer.Write(settings.stop_label_font_size);
+            writer.Write(settings.stop_label_offset.x);
+            writer.Write(settings.stop_label_offset.y);
+            WriteColor(writer, settings.underlayer_color);
+            writer.Write(settings.underlayer_width);
+            writer.Write(static_cast<uint32_t>(settings.color_palette.size()));
+            for (const svg::Color& color : settings.color_palette) {
+                WriteColor(writer, color);
+            }
+        }
+
+        renderer::Settings ReadRenderSettings(Reader& reader) {
+            renderer::Settings settings;
+            settings.width = reader.Read<double>();
+            settings.height = reader.Read<double>();
+            settings.padding = reader.Read<double>();
+            settings.line_width = reader.Read<double>();
+            settings.stop_radius = reader.Read<double>();
+            settings.bus_label_font_size = reader.Read<uint32_t>();
+            settings.bus_label_offset.x = reader.Read<double>();
+            settings.bus_label_offset.y = reader.Read<double>();
+            settings.stop_label_font_size = reader.Read<uint32_t>();
+            settings.stop_label_offset.x = reader.Read<double>();
+            settings.stop_label_offset.y = reader.Read<double>();
+            settings.underlayer_color = ReadColor(reader);
+            settings.underlayer_width = reader.Read<double>();
+            const uint32_t palette_size = reader.Read<uint32_t>();
+            for (uint32_t i = 0; i < palette_size; ++i) {
+                settings.color_palette.push_back(ReadColor(reader));
+            }
+            return settings;
+        }
+
+    }  // namespace
+
+// ---------- Save ----------
+
+    void SaveBase(const std::string& path,
+                  const transport::Catalogue& catalogue,
+                  const renderer::Settings& render_settings,
+                  const domain::router_data::Settings& routing_settings) {
+        Writer writer;
+        writer.WriteRaw(MAGIC);
+        writer.Write(FORMAT_VERSION);
+        writer.Write(BYTE_ORDER_MARK);
+
+        // После удалений в каталоге остаются неиспользуемые номера остановок,
+        // в файл живые остановки пишутся подряд, номера переназначаются
+        std::vector<const domain::Stop*> stops(catalogue.GetStopCount(), nullptr);
+        for (const domain::Stop* stop : catalogue.GetAllStops()) {
+            stops.at(stop->id) = stop;
+        }
+        std::vector<uint32_t> new_ids(stops.size(), NO_STOP);
+        uint32_t stop_count = 0;
+        for (size_t id = 0; id < stops.size(); ++id) {
+            if (stops[id] != nullptr) {
+                new_ids[id] = stop_count++;
+            }
+        }
+        writer.Write(stop_count);
+        for (const domain::Stop* stop : stops) {
+            if (stop == nullptr) {
+                continue;
+            }
+            writer.WriteString(stop->name);
+            writer.Write(stop->coordinates.lat);
+            writer.Write(stop->coordinates.lng);
+        }
+
+        const domain::DistanceTable& distances = catalogue.GetDistanceTable();
+        uint32_t distance_count = 0;
+        distances.ForEach([&](uint32_t from, uint32_t to, double){
+            distance_count += new_ids[from] != NO_STOP && new_ids[to] != NO_STOP;
+        });
+        writer.Write(distance_count);
+        distances.ForEach([&](uint32_t from, uint32_t to, double distance){
+            if (new_ids[from] != NO_STOP && new_ids[to] != NO_STOP) {
+                writer.Write(new_ids[from]);
+                writer.Write(new_ids[to]);
+                writer.Write(distance);
+            }
+        });
+
+        writer.Write(static_cast<uint32_t>(catalogue.GetAllBus().size()));
+        for (const domain::Bus* bus : catalogue.GetAllBus()) {
+            writer.WriteString(bus->name);
+            writer.Write(static_cast<uint8_t>(bus->is_roundtrip));
+            writer.Write(static_cast<int32_t>(bus->stops_count));
+            writer.Write(static_cast<int32_t>(bus->unique_stops));
+            writer.Write(bus->length);
+            writer.Write(bus->geo_length);
+            writer.Write(bus->curvature);
+            writer.Write(static_cast<uint32_t>(bus->stops.size()));
+            for (const domain::Stop* stop : bus->stops) {
+                writer.Write(new_ids[stop->id]);
+            }
+        }
+
+        WriteRenderSettings(writer, render_settings);
+        writer.Write(static_cast<int32_t>(routing_settings.bus_wait_time));
+        writer.Write(routing_settings.velocity);
+        writer.Write(static_cast<uint8_t>(routing_settings.route_table_policy));
+
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+        if (!output) {
+            throw std::runtime_error("Can't create base file "s + path);
+        }
+        output.write(writer.GetBuffer().data(), static_cast<std::streamsize>(writer.GetBuffer().size()));
+        if (!output) {
+            throw std::runtime_error("Failed to write base file "s + path);
+        }
+    }
+
+// ---------- Load ----------
+
+    void LoadBase(const std::string& path,
+                  transport::Catalogue& catalogue,
+                  renderer::Settings& render_settings,
+                  domain::router_data::Settings& routing_settings) {
+        FileData file(path);
+        if (static_cast<size_t>(file.end() - file.begin()) < MAGIC.size()
+            || std::string_view(file.begin(), MAGIC.size()) != MAGIC) {
+            throw std::runtime_error("Not a transport catalogue base: "s + path);
+        }
+        Reader reader(file.begin() + MAGIC.size(), file.end());
+        if (reader.Read<uint32_t>() != FORMAT_VERSION) {
+            throw std::runtime_error("Unsupported base file version: "s + path);
+        }
+        if (reader.Read<uint32_t>() != BYTE_ORDER_MARK) {
+            throw std::runtime_error("Base file was written with a different byte order: "s + path);
+        }
+
+        const uint32_t stop_count = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < stop_count; ++i) {
+            const std::string_view name = catalogue.InternName(reader.ReadString());
+            const double lat = reader.Read<double>();
+            const double lng = reader.Read<double>();
+            catalogue.AddStop(domain::Stop(name, lat, lng));
+        }
+
+        const uint32_t distance_count = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < distance_count; ++i) {
+            const uint32_t from = reader.Read<uint32_t>();
+            const uint32_t to = reader.Read<uint32_t>();
+            const double distance = reader.Read<double>();
+            if (from >= stop_count || to >= stop_count) {
+                throw std::runtime_error("Corrupted distance record in base file");
+            }
+            catalogue.AddDistance(from, to, distance);
+        }
+
+        const uint32_t bus_count = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < bus_count; ++i) {
+            domain::Bus bus;
+            bus.name = catalogue.InternName(reader.ReadString());
+            bus.is_roundtrip = reader.Read<uint8_t>() != 0;
+            bus.stops_count = reader.Read<int32_t>();
+            bus.unique_stops = reader.Read<int32_t>();
+            bus.length = reader.Read<double>();
+            bus.geo_length = reader.Read<double>();
+            bus.curvature = reader.Read<double>();
+            // Размер проверяется до reserve: в испорченном файле он может потребовать гигабайты
+            const uint32_t route_size = reader.Read<uint32_t>();
+            if (route_size > reader.RemainingItems(sizeof(uint32_t))) {
+                throw std::runtime_error("Corrupted bus record in base file");
+            }
+            bus.stops.reserve(route_size);
+            for (uint32_t j = 0; j < route_size; ++j) {
+                const uint32_t stop_id = reader.Read<uint32_t>();
+                if (stop_id >= stop_count) {
+                    throw std::runtime_error("Corrupted bus record in base file");
+                }
+                bus.stops.push_back(catalogue.GetStopById(stop_id));
+            }
+            catalogue.AddBus(std::move(bus));
+        }
+
+        render_settings = ReadRenderSettings(reader);
+        routing_settings.bus_wait_time = reader.Read<int32_t>();
+        routing_settings.velocity = reader.Read<double>();
+        routing_settings.route_table_policy = static_cast<memory::PagePolicy>(reader.Read<uint8_t>());
+    }
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+#include "domain.h"
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+
+namespace serialization {
+
+    // Формат файла базы (все числа - в порядке байт машины, на которой база создана):
+    //   заголовок: "TCDB", версия (uint32), маркер порядка байт (uint32)
+    //   остановки: количество, затем имя, широта, долгота - в порядке Stop::id
+    //   расстояния: количество, затем номер откуда, номер куда, расстояние - только
+    //               заданные явно, обратные выводятся при чтении
+    //   маршруты: количество, затем имя, признак кольцевого, статистика и номера остановок
+    //   настройки отрисовки и маршрутизации
+    // Строки записываются как длина (uint32) и байты без завершающего нуля.
+    inline constexpr uint32_t FORMAT_VERSION = 2;
+
+    void SaveBase(const std::string& path,
+                  const transport::Catalogue& catalogue,
+                  const renderer::Settings& render_settings,
+                  const domain::router_data::Settings& routing_settings);
+
+    // Заполняет пустой каталог из файла базы. Выбрасывает std::runtime_error,
+    // если файл не открывается, повреждён или записан другой версией формата
+    void LoadBase(const std::string& path,
+                  transport::Catalogue& catalogue,
+                  renderer::Settings& render_settings,
+                  domain::router_data::Settings& routing_settings);
+
+}
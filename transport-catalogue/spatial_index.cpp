@@ -0,0 +1,215 @@
+#define _USE_MATH_DEFINES
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace spatial {
+
+    StopIndex::Point StopIndex::ToPoint(geo::Coordinates coordinates) {
+        const double dr = M_PI / 180.0;
+        const double lat = coordinates.lat * dr;
+        const double lng = coordinates.lng * dr;
+        return {std::cos(lat) * std::cos(lng), std::cos(lat) * std::sin(lng), std::sin(lat)};
+    }
+
+    double StopIndex::SquaredChord(const Point& lhs, const Point& rhs) {
+        double result = 0.0;
+        for (size_t i = 0; i < 3; ++i) {
+            result += (lhs[i] - rhs[i]) * (lhs[i] - rhs[i]);
+        }
+        return result;
+    }
+
+    void StopIndex::Build(const std::vector<Stop*>& stops, const std::vector<double>& lat,
+                          const std::vector<double>& lng) {
+        nodes_.clear();
+        nodes_.reserve(stops.size());
+        for (Stop* stop : stops) {
+            Node node;
+            node.coordinates = {lat[stop->id], lng[stop->id]};
+            node.point = ToPoint(node.coordinates);
+            node.stop = stop;
+            nodes_.push_back(node);
+        }
+        BuildRange(0, nodes_.size());
+    }
+
+    void StopIndex::BuildRange(size_t begin, size_t end) {
+        if (begin >= end) {
+            return;
+        }
+        // Делим по оси с наибольшим разбросом
+        Point low = nodes_[begin].point;
+        Point high = low;
+        for (size_t i = begin; i < end; ++i) {
+            for (size_t axis = 0; axis < 3; ++axis) {
+                low[axis] = std::min(low[axis], nodes_[i].point[axis]);
+                high[axis] = std::max(high[axis], nodes_[i].point[axis]);
+            }
+        }
+        uint8_t axis = 0;
+        for (uint8_t i = 1; i < 3; ++i) {
+            if (high[i] - low[i] > high[axis] - low[axis]) {
+                axis = i;
+            }
+        }
+
+        const size_t mid = begin + (end - begin) / 2;
+        std::nth_element(nodes_.begin() + begin, nodes_.begin() + mid, nodes_.begin() + end,
+            [axis](const Node& lhs, const Node& rhs){
+                return lhs.point[axis] < rhs.point[axis];
+            });
+        BuildRange(begin, mid);
+        BuildRange(mid + 1, end);
+
+        Node& node = nodes_[mid];
+        node.axis = axis;
+        node.min = node.coordinates;
+        node.max = node.coordinates;
+        auto merge_child = [this, &node](size_t child_begin, size_t child_end) {
+            if (child_begin >= child_end) {
+                return;
+            }
+            const Node& child = nodes_[child_begin + (child_end - child_begin) / 2];
+            node.min.lat = std::min(node.min.lat, child.min.lat);
+            node.min.lng = std::min(node.min.lng, child.min.lng);
+            node.max.lat = std::max(node.max.lat, child.max.lat);
+            node.max.lng = std::max(node.max.lng, child.max.lng);
+        };
+        merge_child(begin, mid);
+        merge_child(mid + 1, end);
+    }
+
+    std::vector<Stop*> StopIndex::GetNearest(geo::Coordinates point, size_t count) const {
+        if (count == 0 || nodes_.empty()) {
+            return {};
+        }
+        // Хорды count ближайших задают радиус отбора. В него берутся все точки не дальше
+        // count-й с запасом: и равные ей по расстоянию, чтобы выбор среди них решало имя,
+        // и почти равные, которые ComputeDistance может расставить иначе, чем хорда
+        const Point target = ToPoint(point);
+        std::vector<double> heap;
+        heap.reserve(count + 1);
+        SearchNearest(0, nodes_.size(), target, count, heap);
+        double radius = std::numeric_limits<double>::infinity();
+        if (heap.size() == count) {
+            radius = std::sqrt(heap.front()) + TIE_MARGIN;
+            radius *= radius;
+        }
+        std::vector<size_t> candidates;
+        SearchWithin(0, nodes_.size(), target, radius, candidates);
+
+        std::vector<std::pair<double, Stop*>> found;
+        found.reserve(candidates.size());
+        for (size_t index : candidates) {
+            found.push_back({geo::ComputeDistance(point, nodes_[index].coordinates), nodes_[index].stop});
+        }
+        std::sort(found.begin(), found.end(), [](const auto& lhs, const auto& rhs){
+            if (lhs.first != rhs.first) {
+                return lhs.first < rhs.first;
+            }
+            return domain::NameLess()(lhs.second, rhs.second);
+        });
+        found.resize(std::min(found.size(), count));
+
+        std::vector<Stop*> result;
+        result.reserve(found.size());
+        for (const auto& item : found) {
+            result.push_back(item.second);
+        }
+        return result;
+    }
+
+    void StopIndex::SearchNearest(size_t begin, size_t end, const Point& target, size_t count,
+                                  std::vector<double>& heap) const {
+        if (begin >= end) {
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        const Node& node = nodes_[mid];
+
+        const double chord = SquaredChord(node.point, target);
+        if (heap.size() < count || chord < heap.front()) {
+            heap.push_back(chord);
+            std::push_heap(heap.begin(), heap.end());
+            if (heap.size() > count) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.pop_back();
+            }
+        }
+
+        const double diff = target[node.axis] - node.point[node.axis];
+        const bool left_first = diff < 0;
+        if (left_first) {
+            SearchNearest(begin, mid, target, count, heap);
+        } else {
+            SearchNearest(mid + 1, end, target, count, heap);
+        }
+        // Вторую половину смотрим, только если плоскость разбиения ближе худшего из найденных
+        if (heap.size() < count || diff * diff < heap.front()) {
+            if (left_first) {
+                SearchNearest(mid + 1, end, target, count, heap);
+            } else {
+                SearchNearest(begin, mid, target, count, heap);
+            }
+        }
+    }
+
+    void StopIndex::SearchWithin(size_t begin, size_t end, const Point& target, double radius,
+                                 std::vector<size_t>& result) const {
+        if (begin >= end) {
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        const Node& node = nodes_[mid];
+        if (SquaredChord(node.point, target) <= radius) {
+            result.push_back(mid);
+        }
+        const double diff = target[node.axis] - node.point[node.axis];
+        if (diff < 0 || diff * diff <= radius) {
+            SearchWithin(begin, mid, target, radius, result);
+        }
+        if (diff >= 0 || diff * diff <= radius) {
+            SearchWithin(mid + 1, end, target, radius, result);
+        }
+    }
+
+    std::vector<Stop*> StopIndex::GetInBox(geo::Coordinates min, geo::Coordinates max) const {
+        std::vector<Stop*> result;
+        SearchBox(0, nodes_.size(), min, max, result);
+        std::sort(result.begin(), result.end(), domain::NameLess());
+        return result;
+    }
+
+    void StopIndex::SearchBox(size_t begin, size_t end, geo::Coordinates min, geo::Coordinates max,
+                              std::vector<Stop*>& result) const {
+        if (begin >= end) {
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        const Node& node = nodes_[mid];
+        if (node.max.lat < min.lat || node.min.lat > max.lat
+            || node.max.lng < min.lng || node.min.lng > max.lng) {
+            return;
+        }
+        const geo::Coordinates& coordinates = node.coordinates;
+        if (coordinates.lat >= min.lat && coordinates.lat <= max.lat
+            && coordinates.lng >= min.lng && coordinates.lng <= max.lng) {
+            result.push_back(node.stop);
+        }
+        SearchBox(begin, mid, min, max, result);
+        SearchBox(mid + 1, end, min, max, result);
+    }
+
+    size_t StopIndex::Size() const {
+        return nodes_.size();
+    }
+
+    memory::Usage StopIndex::GetMemoryUsage() const {
+        return memory::OfVector("catalogue.spatial_index", nodes_);
+    }
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "domain.h"
+#include "geo.h"
+
+namespace spatial {
+
+    using domain::Stop;
+
+    // k-d дерево над остановками.
+    // Точки хранятся как единичные векторы в трёхмерном пространстве: хорда между ними
+    // монотонна по расстоянию на сфере, поэтому порядок соседей совпадает с geo::ComputeDistance.
+    // Каждый узел также хранит границы своего поддерева по широте и долготе для запросов по прямоугольнику.
+    class StopIndex {
+        public:
+            // Координаты берутся из столбцов каталога lat и lng, индекс - Stop::id
+            void Build(const std::vector<Stop*>& stops, const std::vector<double>& lat,
+                       const std::vector<double>& lng);
+
+            // count ближайших к точке остановок в порядке возрастания geo::ComputeDistance,
+            // при равенстве - в порядке domain::NameLess
+            std::vector<Stop*> GetNearest(geo::Coordinates point, size_t count) const;
+
+            // Остановки, у которых min.lat <= lat <= max.lat и min.lng <= lng <= max.lng,
+            // в порядке domain::NameLess
+            std::vector<Stop*> GetInBox(geo::Coordinates min, geo::Coordinates max) const;
+
+            size_t Size() const;
+
+            memory::Usage GetMemoryUsage() const;
+
+        private:
+            using Point = std::array<double, 3>;
+
+            // Запас к радиусу отбора в GetNearest, в радиусах Земли (около 6 м). Намного больше
+            // погрешности ComputeDistance, у которой acos вблизи 1 ошибается на доли метра
+            static constexpr double TIE_MARGIN = 1e-6;
+
+            struct Node {
+                Point point;
+                geo::Coordinates coordinates;
+                Stop* stop = nullptr;
+                uint8_t axis = 0;
+                geo::Coordinates min;
+                geo::Coordinates max;
+            };
+
+            // Неявное дерево: корнем диапазона [begin, end) служит узел (begin + end) / 2
+            std::vector<Node> nodes_;
+
+            static Point ToPoint(geo::Coordinates coordinates);
+            static double SquaredChord(const Point& lhs, const Point& rhs);
+
+            void BuildRange(size_t begin, size_t end);
+            void SearchNearest(size_t begin, size_t end, const Point& target, size_t count,
+                               std::vector<double>& heap) const;
+            // Все узлы с квадратом хорды до target не больше radius
+            void SearchWithin(size_t begin, size_t end, const Point& target, double radius,
+                              std::vector<size_t>& result) const;
+            void SearchBox(size_t begin, size_t end, geo::Coordinates min, geo::Coordinates max,
+                           std::vector<Stop*>& result) const;
+    };
+
+}
@@ -1,86 +1,453 @@
 #include "transport_catalogue.h"
+#include "parallel.h"
+
+#include <stdexcept>
 
 namespace transport{
 
+    using namespace std::literals;
+
     using domain::Stop;
     using domain::Bus;
-    using domain::StopPairHasher;
     using domain::PairHasher;
 
 // ---------- Catalogue ---------
 
+    std::string_view Catalogue::InternName(std::string_view name){
+        return names_.Intern(name);
+    }
+
     void Catalogue::AddStop(domain::Stop&& stop){
+        CheckNotFrozen();
+        stop.id = static_cast<uint32_t>(stops_.size());
+        stop_lat_.push_back(stop.coordinates.lat);
+        stop_lng_.push_back(stop.coordinates.lng);
+        stop_sin_lat_.push_back(geo::SinLatitude(stop.coordinates.lat));
+        stop_cos_lat_.push_back(geo::CosLatitude(stop.coordinates.lat));
         stops_.push_back(std::move(stop));
         std::string_view new_name = stops_.back().name;
         Stop* stop_pointer = &stops_.back();
         stops_id_.insert({new_name,stop_pointer});
+        stops_changed_ = true;
     }
 
     void Catalogue::AddDistances(const DistancesStringMap& distances){
+        CheckNotFrozen();
+        distances_.Reserve(distances_.Size() + distances.size());
         for (const auto& [stop_pair,dst] : distances){
-            Stop* stop1 = GetStop(stop_pair.first).value();
-            Stop* stop2 = GetStop(stop_pair.second).value();
-            distances_[std::make_pair(stop1,stop2)] = dst;
-            if (!distances_.count(std::make_pair(stop2,stop1))){
-                distances_[std::make_pair(stop2,stop1)] = dst;
-            }
+            const uint32_t id1 = GetStop(stop_pair.first).value()->id;
+            const uint32_t id2 = GetStop(stop_pair.second).value()->id;
+            distances_.Set(id1,id2,dst);
         }
     }
 
+    void Catalogue::AddDistance(uint32_t from_id, uint32_t to_id, double distance){
+        CheckNotFrozen();
+        distances_.Set(from_id,to_id,distance);
+    }
+
     Bus* Catalogue::AddBus(domain::Bus&& bus){
+        CheckNotFrozen();
+        bus.id = static_cast<uint32_t>(buses_.size());
+        for (const Stop* stop : bus.stops) {
+            bus_stop_ids_.push_back(stop->id);
+        }
+        bus_stop_offsets_.push_back(static_cast<uint32_t>(bus_stop_ids_.size()));
         buses_.push_back(std::move(bus));
         std::string_view name = buses_.back().name;       
         Bus* bus_pointer = &buses_.back();
         buses_id_.insert({name,bus_pointer});
+        buses_changed_ = true;
         return bus_pointer;
     }
 
-    std::optional<Stop*> Catalogue::GetStop(const std::string& stop_name) const {
-        return stops_id_.count(stop_name) ? stops_id_.at(stop_name) : nullptr;
+    std::optional<Stop*> Catalogue::GetStop(std::string_view stop_name) const {
+        if (frozen_) {
+            return frozen_stops_.Find(stop_name).value_or(nullptr);
+        }
+        auto it = stops_id_.find(stop_name);
+        return it != stops_id_.end() ? it->second : nullptr;
     }
 
-    std::optional<Bus*> Catalogue::GetBus(const std::string& bus_name) const{
-        return buses_id_.count(bus_name) ? buses_id_.at(bus_name) : nullptr;
+    std::optional<Bus*> Catalogue::GetBus(std::string_view bus_name) const{
+        if (frozen_) {
+            return frozen_buses_.Find(bus_name).value_or(nullptr);
+        }
+        auto it = buses_id_.find(bus_name);
+        return it != buses_id_.end() ? it->second : nullptr;
     }
 
-    std::optional<double> Catalogue::GetDistance(const std::string& first, const std::string& second) const {
-        
-        auto stop1 = GetStop(first);
-        auto stop2 = GetStop(second);
-        if (!stop1.has_value() || !stop2.has_value()){
-            return false;
+    std::vector<Stop*> Catalogue::GetStops(const std::vector<std::string_view>& stop_names) const {
+        std::vector<Stop*> stops(stop_names.size(), nullptr);
+        if (frozen_) {
+            frozen_stops_.FindBatch(stop_names.data(), stop_names.size(), stops.data());
+            return stops;
+        }
+        for (size_t i = 0; i < stop_names.size(); ++i) {
+            stops[i] = GetStop(stop_names[i]).value();
+        }
+        return stops;
+    }
+
+    std::vector<Bus*> Catalogue::GetBuses(const std::vector<std::string_view>& bus_names) const {
+        std::vector<Bus*> buses(bus_names.size(), nullptr);
+        if (frozen_) {
+            frozen_buses_.FindBatch(bus_names.data(), bus_names.size(), buses.data());
+            return buses;
         }
-        auto stop_pair = std::make_pair(stop1.value(),stop2.value());
+        for (size_t i = 0; i < bus_names.size(); ++i) {
+            buses[i] = GetBus(bus_names[i]).value();
+        }
+        return buses;
+    }
+
+    Stop* Catalogue::GetStopById(uint32_t stop_id) {
+        return &stops_.at(stop_id);
+    }
+
+    const DistanceTable& Catalogue::GetDistanceTable() const {
+        return distances_;
+    }
+
+    std::optional<double> Catalogue::GetDistance(std::string_view first, std::string_view second) const {
         
-        if (distances_.count(stop_pair)){
-            return distances_.at(stop_pair);
+        Stop* stop1 = GetStop(first).value();
+        Stop* stop2 = GetStop(second).value();
+        if (stop1 == nullptr || stop2 == nullptr){
+            return std::nullopt;
         }
-        return false;
+        return GetDistance(stop1->id,stop2->id);
     }
 
-    std::vector<Bus*> Catalogue::GetAllBus() const {
+    std::optional<double> Catalogue::GetDistance(uint32_t first_id, uint32_t second_id) const {
+        if (auto distance = distances_.Get(first_id,second_id)) {
+            return distance;
+        }
+        return distances_.Get(second_id,first_id);
+    }
+
+    const std::vector<Bus*>& Catalogue::GetAllBus() const {
         return all_buses_;
     }
 
-    std::vector<Stop*> Catalogue::GetAllStops() const {
+    const std::vector<Stop*>& Catalogue::GetAllStops() const {
         return all_stops_;
     }
 
+    Catalogue::BusRange Catalogue::GetStopBuses(const Stop* stop) const {
+        if (stop->id + 1 >= stop_buses_offsets_.size()) {
+            return BusRange(stop_buses_.end(), stop_buses_.end());
+        }
+        return BusRange(stop_buses_.begin() + stop_buses_offsets_[stop->id],
+                        stop_buses_.begin() + stop_buses_offsets_[stop->id + 1]);
+    }
+
+    bool Catalogue::HasBuses(const Stop* stop) const {
+        return HasBuses(stop->id);
+    }
+
+    bool Catalogue::HasBuses(uint32_t stop_id) const {
+        return stop_id + 1 < stop_buses_offsets_.size()
+            && stop_buses_offsets_[stop_id] != stop_buses_offsets_[stop_id + 1];
+    }
+
+    size_t Catalogue::GetStopCount() const {
+        return stop_lat_.size();
+    }
+
+    geo::Coordinates Catalogue::GetStopCoordinates(uint32_t stop_id) const {
+        return {stop_lat_[stop_id], stop_lng_[stop_id]};
+    }
+
+    Catalogue::StopIdRange Catalogue::GetBusStopIds(const Bus* bus) const {
+        return StopIdRange(bus_stop_ids_.begin() + bus_stop_offsets_.at(bus->id),
+                           bus_stop_ids_.begin() + bus_stop_offsets_.at(bus->id + 1));
+    }
+
+    double Catalogue::ComputeGeoLength(const Bus* bus) const {
+        double length = 0.0;
+        auto ids = GetBusStopIds(bus);
+        for (auto it = ids.begin(); it != ids.end() && std::next(it) != ids.end(); ++it) {
+            length += GetGeoDistance(*it, *std::next(it));
+        }
+        return length;
+    }
+
+    void Catalogue::CacheGeoDistances(const std::vector<std::pair<uint32_t,uint32_t>>& stop_pairs,
+                                      size_t thread_count) {
+        std::vector<uint32_t> from;
+        std::vector<uint32_t> to;
+        for (auto [first, second] : stop_pairs) {
+            if (first > second) {
+                std::swap(first, second);
+            }
+            if (geo_distances_.Insert(first, second, 0.0)) {
+                from.push_back(first);
+                to.push_back(second);
+            }
+        }
+        std::vector<double> distances(from.size());
+        parallel::ForRanges(distances.size(), thread_count, [&](size_t begin, size_t end){
+            geo::ComputeDistances(stop_sin_lat_.data(), stop_cos_lat_.data(), stop_lng_.data(),
+                                  from.data() + begin, to.data() + begin, distances.data() + begin, end - begin);
+        });
+        for (size_t i = 0; i < distances.size(); ++i) {
+            geo_distances_.Set(from[i], to[i], distances[i]);
+        }
+    }
+
+    double Catalogue::GetGeoDistance(uint32_t from_id, uint32_t to_id) const {
+        if (from_id > to_id) {
+            std::swap(from_id, to_id);
+        }
+        if (auto distance = geo_distances_.Get(from_id, to_id)) {
+            return *distance;
+        }
+        double distance = 0.0;
+        geo::ComputeDistances(stop_sin_lat_.data(), stop_cos_lat_.data(), stop_lng_.data(),
+                              &from_id, &to_id, &distance, 1);
+        return distance;
+    }
+
+    std::vector<Stop*> Catalogue::GetNearestStops(geo::Coordinates point, size_t count) const {
+        return stop_index_.GetNearest(point, count);
+    }
+
+    std::vector<Stop*> Catalogue::GetStopsInBox(geo::Coordinates min, geo::Coordinates max) const {
+        return stop_index_.GetInBox(min, max);
+    }
+
+    std::vector<Stop*> Catalogue::FindStopsByPrefix(std::string_view prefix, size_t count) const {
+        // Имена с общим префиксом идут в отсортированном массиве подряд, начиная
+        // с первого имени не меньше префикса
+        size_t low = 0;
+        size_t high = prefix_stops_.size();
+        while (low < high) {
+            const size_t mid = low + (high - low) / 2;
+            if (GetSortedStopName(mid) < prefix) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        std::vector<Stop*> stops;
+        for (size_t i = low; i < prefix_stops_.size() && stops.size() < count
+                             && GetSortedStopName(i).substr(0, prefix.size()) == prefix; ++i) {
+            stops.push_back(prefix_stops_[i]);
+        }
+        return stops;
+    }
+
+    std::string_view Catalogue::GetSortedStopName(size_t index) const {
+        return {stop_name_chars_.data() + stop_name_offsets_[index],
+                stop_name_offsets_[index + 1] - stop_name_offsets_[index]};
+    }
+
+    void Catalogue::BuildStopBuses() {
+        std::vector<Bus*> buses = all_buses_;
+        std::sort(buses.begin(), buses.end(), domain::NameLess());
+
+        // Первый проход считает маршруты каждой остановки, второй раскладывает их по местам.
+        // last_bus не даёт учесть маршрут дважды, если он проходит остановку несколько раз
+        const uint32_t no_bus = static_cast<uint32_t>(buses.size());
+        std::vector<uint32_t> last_bus(stops_.size(), no_bus);
+        stop_buses_offsets_.assign(stops_.size() + 1, 0);
+        for (uint32_t bus_index = 0; bus_index < buses.size(); ++bus_index) {
+            for (const Stop* stop : buses[bus_index]->stops) {
+                if (last_bus[stop->id] != bus_index) {
+                    last_bus[stop->id] = bus_index;
+                    ++stop_buses_offsets_[stop->id + 1];
+                }
+            }
+        }
+        for (size_t i = 1; i < stop_buses_offsets_.size(); ++i) {
+            stop_buses_offsets_[i] += stop_buses_offsets_[i - 1];
+        }
+
+        stop_buses_.assign(stop_buses_offsets_.back(), nullptr);
+        std::vector<uint32_t> next(stop_buses_offsets_.begin(), stop_buses_offsets_.end() - 1);
+        last_bus.assign(stops_.size(), no_bus);
+        for (uint32_t bus_index = 0; bus_index < buses.size(); ++bus_index) {
+            for (const Stop* stop : buses[bus_index]->stops) {
+                if (last_bus[stop->id] != bus_index) {
+                    last_bus[stop->id] = bus_index;
+                    stop_buses_[next[stop->id]++] = buses[bus_index];
+                }
+            }
+        }
+    }
+
     void Catalogue::SortAll() {
-        for (auto [name,bus]: buses_id_) {
-            all_buses_.push_back(bus);
+        CheckNotFrozen();
+        // all_buses_ и all_stops_ упорядочены по байтам со знаком (lexicographical_compare
+        // над char): в этом порядке рисуется карта, и он сохраняется ради прежнего вывода
+        if (buses_changed_) {
+            all_buses_.clear();
+            for (auto [name,bus]: buses_id_) {
+                all_buses_.push_back(bus);
+            }
+            std::sort(all_buses_.begin(), all_buses_.end(),[](Bus* lhs, Bus* rhs){
+                return std::lexicographical_compare(lhs->name.begin(),lhs->name.end(),
+                            rhs->name.begin(),rhs->name.end());
+            });
+        }
+        if (stops_changed_) {
+            all_stops_.clear();
+            for (auto [name,stop]: stops_id_) {
+                all_stops_.push_back(stop);
+            }
+            std::sort(all_stops_.begin(),all_stops_.end(),[](Stop* lhs, Stop* rhs){
+                return std::lexicographical_compare(lhs->name.begin(),lhs->name.end(),
+                            rhs->name.begin(),rhs->name.end());
+            });
+            prefix_stops_ = all_stops_;
+            std::sort(prefix_stops_.begin(), prefix_stops_.end(), domain::NameLess());
+            stop_name_chars_.clear();
+            stop_name_offsets_.assign(1, 0);
+            for (const Stop* stop : prefix_stops_) {
+                stop_name_chars_.insert(stop_name_chars_.end(), stop->name.begin(), stop->name.end());
+                stop_name_offsets_.push_back(static_cast<uint32_t>(stop_name_chars_.size()));
+            }
+            stop_index_.Build(all_stops_, stop_lat_, stop_lng_);
         }
-        std::sort(all_buses_.begin(), all_buses_.end(),[](Bus* lhs, Bus* rhs){
-            return lexicographical_compare(lhs->name.begin(),lhs->name.end(),
-                        rhs->name.begin(),rhs->name.end());
+        // Смежность индексируется номерами остановок, поэтому зависит и от их числа
+        if (buses_changed_ || stops_changed_) {
+            BuildStopBuses();
+        }
+        stops_changed_ = false;
+        buses_changed_ = false;
+    }
+
+    void Catalogue::Unfreeze() {
+        frozen_ = false;
+        frozen_stops_ = {};
+        frozen_buses_ = {};
+    }
+
+    void Catalogue::MoveStop(Stop* stop, geo::Coordinates coordinates) {
+        CheckNotFrozen();
+        stop->coordinates = coordinates;
+        stop_lat_[stop->id] = coordinates.lat;
+        stop_lng_[stop->id] = coordinates.lng;
+        stop_sin_lat_[stop->id] = geo::SinLatitude(coordinates.lat);
+        stop_cos_lat_[stop->id] = geo::CosLatitude(coordinates.lat);
+
+        // В кэше только перегоны маршрутов, так что полный проход дешевле,
+        // чем отдельный индекс пар по остановкам
+        std::vector<std::pair<uint32_t,uint32_t>> stale;
+        geo_distances_.ForEach([&stale, id = stop->id](uint32_t from, uint32_t to, double){
+            if (from == id || to == id) {
+                stale.push_back({from, to});
+            }
         });
-        for (auto [name,stop]: stops_id_) {
-            all_stops_.push_back(stop);
+        for (auto [from, to] : stale) {
+            geo_distances_.Erase(from, to);
         }
-        std::sort(all_stops_.begin(),all_stops_.end(),[](Stop* lhs, Stop* rhs){
-            return lexicographical_compare(lhs->name.begin(),lhs->name.end(),
-                        rhs->name.begin(),rhs->name.end());
+        stops_changed_ = true;
+    }
+
+    void Catalogue::RemoveStop(Stop* stop) {
+        CheckNotFrozen();
+        for (auto [name, bus] : buses_id_) {
+            if (std::find(bus->stops.begin(), bus->stops.end(), stop) != bus->stops.end()) {
+                throw std::invalid_argument("Stop "s + std::string(stop->name) + " is used by bus "s + std::string(name));
+            }
+        }
+        stops_id_.erase(stop->name);
+        stops_changed_ = true;
+    }
+
+    void Catalogue::RemoveBus(Bus* bus) {
+        CheckNotFrozen();
+        buses_id_.erase(bus->name);
+        std::vector<Stop*>().swap(bus->stops);
+        buses_changed_ = true;
+    }
+
+    void Catalogue::RemoveDistance(uint32_t from_id, uint32_t to_id) {
+        CheckNotFrozen();
+        distances_.Erase(from_id, to_id);
+    }
+
+    void Catalogue::RemoveDistancesFrom(uint32_t from_id) {
+        CheckNotFrozen();
+        std::vector<uint32_t> stale;
+        distances_.ForEach([&stale, from_id](uint32_t from, uint32_t to, double){
+            if (from == from_id) {
+                stale.push_back(to);
+            }
         });
+        for (uint32_t to : stale) {
+            distances_.Erase(from_id, to);
+        }
+    }
+
+    void Catalogue::Freeze() {
+        if (frozen_) {
+            return;
+        }
+        std::vector<std::pair<std::string_view,Stop*>> stops(stops_id_.begin(),stops_id_.end());
+        frozen_stops_.Build(stops);
+        std::vector<std::pair<std::string_view,Bus*>> buses(buses_id_.begin(),buses_id_.end());
+        frozen_buses_.Build(buses);
+        frozen_ = true;
+    }
+
+    bool Catalogue::IsFrozen() const {
+        return frozen_;
+    }
+
+    void Catalogue::CheckNotFrozen() const {
+        if (frozen_) {
+            throw std::logic_error("Catalogue is frozen");
+        }
+    }
+
+    memory::Report Catalogue::GetMemoryUsage() const {
+        memory::Report report = names_.GetMemoryUsage();
+
+        report.push_back(memory::OfDeque("catalogue.stops", stops_));
+        report.push_back(memory::OfVector("catalogue.all_stops", all_stops_));
+        memory::Usage stop_names = memory::OfVector("catalogue.stop_names", stop_name_chars_);
+        for (const memory::Usage& part : {memory::OfVector("", stop_name_offsets_), memory::OfVector("", prefix_stops_)}) {
+            stop_names.bytes += part.bytes;
+            stop_names.overhead += part.overhead;
+        }
+        report.push_back(stop_names);
+        report.push_back(memory::OfHashContainer("catalogue.stops_id", stops_id_));
+
+        memory::Usage bus_routes {"catalogue.bus_routes"};
+        for (const Bus& bus : buses_) {
+            bus_routes.bytes += bus.stops.size() * sizeof(Stop*);
+            bus_routes.overhead += (bus.stops.capacity() - bus.stops.size()) * sizeof(Stop*);
+        }
+        report.push_back(memory::OfDeque("catalogue.buses", buses_));
+        report.push_back(bus_routes);
+        report.push_back(memory::OfVector("catalogue.all_buses", all_buses_));
+        report.push_back(memory::OfHashContainer("catalogue.buses_id", buses_id_));
+
+        report.push_back(distances_.GetMemoryUsage("catalogue.distances"));
+        report.push_back(geo_distances_.GetMemoryUsage("catalogue.geo_distances"));
+
+        memory::Usage columns {"catalogue.columns"};
+        for (const memory::Usage& column : {memory::OfVector("", stop_lat_), memory::OfVector("", stop_lng_),
+                                            memory::OfVector("", stop_sin_lat_), memory::OfVector("", stop_cos_lat_),
+                                            memory::OfVector("", bus_stop_ids_), memory::OfVector("", bus_stop_offsets_)}) {
+            columns.bytes += column.bytes;
+            columns.overhead += column.overhead;
+        }
+        report.push_back(columns);
+
+        memory::Usage stop_buses = memory::OfVector("catalogue.stop_buses", stop_buses_);
+        memory::Usage offsets = memory::OfVector("", stop_buses_offsets_);
+        stop_buses.bytes += offsets.bytes;
+        stop_buses.overhead += offsets.overhead;
+        report.push_back(stop_buses);
+
+        report.push_back(stop_index_.GetMemoryUsage());
+        report.push_back(frozen_stops_.GetMemoryUsage("catalogue.frozen_stops"));
+        report.push_back(frozen_buses_.GetMemoryUsage("catalogue.frozen_buses"));
+        return report;
     }
 
 }
\ No newline at end of file
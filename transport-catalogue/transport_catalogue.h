@@ -8,49 +8,179 @@
 #include <variant>
 #include <algorithm>
 #include "domain.h"
+#include "name_table.h"
+#include "perfect_hash.h"
+#include "ranges.h"
+#include "spatial_index.h"
 
 namespace transport {
 
 	using domain::Stop;
 	using domain::Bus;
-	using domain::StopPairHasher;
 	using domain::PairHasher;
-	using domain::DistancesStopMap;
+	using domain::DistanceTable;
 	using domain::DistancesStringMap;
 
 	class Catalogue {
 
 		public:
 
+		// Возвращает постоянное представление имени, хранящееся в каталоге
+		std::string_view InternName(std::string_view name);
+
 		void AddStop(Stop&& stop);
 		
 		Bus* AddBus(Bus&& bus);
 
+		// В таблице хранятся только заданные явно расстояния. Обратное направление
+		// не записывается, а выводится в GetDistance, поэтому замена или удаление
+		// расстояния A -> B сразу отражается и на незаданном B -> A
 		void AddDistances(const DistancesStringMap& distances );
 
-		std::optional<Stop*> GetStop(const std::string& stop_name) const;
+		void AddDistance(uint32_t from_id, uint32_t to_id, double distance);
+
+		std::optional<Stop*> GetStop(std::string_view stop_name) const;
+
+		std::optional<Bus*> GetBus(std::string_view bus_name) const;
+
+		// Пакетный поиск по именам, для отсутствующих - nullptr. На замороженном каталоге
+		// заметно быстрее поштучного: обращения к таблице для разных имён перекрываются
+		std::vector<Stop*> GetStops(const std::vector<std::string_view>& stop_names) const;
+
+		std::vector<Bus*> GetBuses(const std::vector<std::string_view>& bus_names) const;
+
+		Stop* GetStopById(uint32_t stop_id);
+
+		const DistanceTable& GetDistanceTable() const;
+
+		std::optional<double> GetDistance(std::string_view first, std::string_view second) const;
+
+		// Если расстояние first -> second не задано, возвращает second -> first
+		std::optional<double> GetDistance(uint32_t first_id, uint32_t second_id) const;
+
+		const std::vector<Bus*>& GetAllBus() const;
+
+		const std::vector<Stop*>& GetAllStops() const; 
+
+		using BusRange = ranges::Range<std::vector<Bus*>::const_iterator>;
+
+		// Маршруты, проходящие через остановку, в порядке возрастания имён.
+		// Заполняется в SortAll; у остановок, добавленных позже, маршрутов нет
+		BusRange GetStopBuses(const Stop* stop) const;
+
+		bool HasBuses(const Stop* stop) const;
+
+		bool HasBuses(uint32_t stop_id) const;
+
+		// Колоночное представление для проходов, которым нужны только координаты
+		// и номера остановок: координаты лежат по Stop::id, последовательности
+		// остановок маршрутов - подряд в одном массиве по Bus::id
+		size_t GetStopCount() const;
+
+		geo::Coordinates GetStopCoordinates(uint32_t stop_id) const;
+
+		using StopIdRange = ranges::Range<std::vector<uint32_t>::const_iterator>;
+
+		StopIdRange GetBusStopIds(const Bus* bus) const;
+
+		double ComputeGeoLength(const Bus* bus) const;
 
-		std::optional<Bus*> GetBus(const std::string& bus_name) const;
+		// Считает географические расстояния для всех ещё не известных пар остановок
+		// одним пакетом (geo::ComputeDistances) и запоминает их. Пары неупорядоченные:
+		// расстояние по сфере симметрично. Пакет делится между thread_count потоками
+		void CacheGeoDistances(const std::vector<std::pair<uint32_t,uint32_t>>& stop_pairs,
+		                       size_t thread_count = 1);
 
-		std::optional<double> GetDistance(const std::string& first, const std::string& second) const;
+		// Расстояние из кэша, а для незакэшированной пары - вычисленное на месте
+		double GetGeoDistance(uint32_t from_id, uint32_t to_id) const;
 
-		std::vector<Bus*> GetAllBus() const;
+		// Пространственные запросы, индекс строится в SortAll
+		std::vector<Stop*> GetNearestStops(geo::Coordinates point, size_t count) const;
 
-		std::vector<Stop*> GetAllStops() const; 
+		std::vector<Stop*> GetStopsInBox(geo::Coordinates min, geo::Coordinates max) const;
 
+		// Первые count остановок в порядке domain::NameLess, имя которых начинается с prefix,
+		// - как в остальных списках остановок в ответах. Двоичный поиск по массиву имён,
+		// который строится в SortAll
+		std::vector<Stop*> FindStopsByPrefix(std::string_view prefix, size_t count) const;
+
+		// Пересобирает упорядоченные списки, смежность остановка -> маршруты
+		// и пространственный индекс - только те, входы которых изменились
 		void SortAll();
 
+		// Изменения загруженного каталога. Удалённые остановки и маршруты пропадают
+		// из поиска по имени и из списков, но их номера не переиспользуются
+		void Unfreeze();
+
+		void MoveStop(Stop* stop, geo::Coordinates coordinates);
+
+		// Выбрасывает std::invalid_argument, если через остановку проходит маршрут
+		void RemoveStop(Stop* stop);
+
+		void RemoveBus(Bus* bus);
+
+		void RemoveDistance(uint32_t from_id, uint32_t to_id);
+
+		// Удаляет все явно заданные расстояния от остановки до других
+		void RemoveDistancesFrom(uint32_t from_id);
+
+		// Переводит каталог в режим только для чтения: имена остановок и маршрутов
+		// ищутся по минимальной совершенной хеш-функции. После Freeze изменять каталог
+		// нельзя, а все const-методы можно вызывать из нескольких потоков
+		void Freeze();
+
+		bool IsFrozen() const;
+
+		memory::Report GetMemoryUsage() const;
+
 		private:
+
+		NameTable names_;
 		
 		std::deque<Stop> stops_;
 		std::vector<Stop*> all_stops_;
+		// Для поиска по префиксу: остановки в порядке domain::NameLess и их имена в том же
+		// порядке, байты всех имён - одним блоком: имя i занимает
+		// [stop_name_offsets_[i], stop_name_offsets_[i + 1])
+		std::vector<Stop*> prefix_stops_;
+		std::vector<char> stop_name_chars_;
+		std::vector<uint32_t> stop_name_offsets_ = {0};
 		std::unordered_map<std::string_view,Stop*> stops_id_;
 		
 		std::deque<Bus> buses_;
 		std::vector<Bus*> all_buses_;
 		std::unordered_map<std::string_view,Bus*> buses_id_;
 
-		DistancesStopMap distances_;
+		std::vector<double> stop_lat_;
+		std::vector<double> stop_lng_;
+		std::vector<double> stop_sin_lat_;
+		std::vector<double> stop_cos_lat_;
+		DistanceTable geo_distances_;
+		std::vector<uint32_t> bus_stop_ids_;
+		std::vector<uint32_t> bus_stop_offsets_ = {0};
+
+		DistanceTable distances_;
+
+		// Смежность остановка -> маршруты в формате CSR: маршруты остановки с номером id
+		// лежат в stop_buses_[stop_buses_offsets_[id], stop_buses_offsets_[id + 1])
+		std::vector<Bus*> stop_buses_;
+		std::vector<uint32_t> stop_buses_offsets_;
+
+		spatial::StopIndex stop_index_;
+
+		// Что изменилось с последнего SortAll
+		bool stops_changed_ = true;
+		bool buses_changed_ = true;
+
+		bool frozen_ = false;
+		perfect_hash::Table<Stop*> frozen_stops_;
+		perfect_hash::Table<Bus*> frozen_buses_;
+
+		void CheckNotFrozen() const;
+
+		void BuildStopBuses();
+
+		std::string_view GetSortedStopName(size_t index) const;
 	};
 
 }
@@ -2,19 +2,25 @@
 
 namespace transport_router{
     void TransportRouter::LoadCatalogue(){
-        graph_ = new graph::DirectedWeightedGraph<Time>(catalogue_.GetAllStops().size()*2);
+        graph_ = std::make_unique<graph::DirectedWeightedGraph<Time>>(catalogue_.GetAllStops().size()*2);
+        // Номера удалённых остановок не переиспользуются, поэтому индекс - по всем номерам
+        stops_.assign(catalogue_.GetStopCount(), StopVertexPair{});
         for (auto stop : catalogue_.GetAllStops()){
             AddStop(stop);
         }
         for (auto bus : catalogue_.GetAllBus()){
             AddBus(bus);
         }
-        router_ = new Router<Time>(*graph_);
+        router_ = std::make_unique<Router<Time>>(*graph_, settings_.route_table_policy);
     }
 
     std::optional<Response> TransportRouter::GetRoute (Stop* start, Stop* end) const {
+        // Маршрут не найден, если неизвестна хотя бы одна из остановок
+        if (start == nullptr || end == nullptr) {
+            return std::nullopt;
+        }
         std::optional<Router<Time>::RouteInfo> info 
-            = router_->BuildRoute(stops_.at(start).stop_begin.id,stops_.at(end).stop_begin.id);
+            = router_->BuildRoute(stops_.at(start->id).stop_begin.id,stops_.at(end->id).stop_begin.id);
         if (!info.has_value()) {
             return std::nullopt;
         }
@@ -41,7 +47,7 @@ namespace transport_router{
         StopVertex new_start {last_id_,stop};
         StopVertex new_finsh {++last_id_,stop};
         ++last_id_;
-        stops_[stop] = StopVertexPair{new_start,new_finsh};
+        stops_[stop->id] = StopVertexPair{new_start,new_finsh};
 
         Edge<Time> new_edge {
             new_start.id,
@@ -65,19 +71,19 @@ namespace transport_router{
             double rev_dist_prev = 0;
             for (auto it_to = std::next(it_from); it_to != it_end; ++it_to){
                 Edge<Time> new_edge;
-                new_edge.from = stops_.at(*it_from).stop_end.id;
-                new_edge.to = stops_.at(*it_to).stop_begin.id;
+                new_edge.from = stops_.at((*it_from)->id).stop_end.id;
+                new_edge.to = stops_.at((*it_to)->id).stop_begin.id;
                 int span_count = static_cast<int>(std::distance(it_from,it_to));
-                double distance = dist_prev + catalogue_.GetDistance((*it_prev)->name,(*it_to)->name).value();
+                double distance = dist_prev + catalogue_.GetDistance((*it_prev)->id,(*it_to)->id).value_or(0.0);
                 dist_prev = distance;
                 double rev_distance = 0;
 
                 Edge<Time> new_edge_reverse;
                 
                 if (!bus->is_roundtrip){
-                    new_edge_reverse.from = stops_.at(*it_to).stop_end.id;
-                    new_edge_reverse.to = stops_.at(*it_from).stop_begin.id;
-                    rev_distance = rev_dist_prev + catalogue_.GetDistance((*it_to)->name,(*it_prev)->name).value();
+                    new_edge_reverse.from = stops_.at((*it_to)->id).stop_end.id;
+                    new_edge_reverse.to = stops_.at((*it_from)->id).stop_begin.id;
+                    rev_distance = rev_dist_prev + catalogue_.GetDistance((*it_to)->id,(*it_prev)->id).value_or(0.0);
                     rev_dist_prev = rev_distance;
                 }
                 it_prev = it_to;
@@ -97,4 +103,20 @@ namespace transport_router{
         }
     }
               
+    memory::Report TransportRouter::GetMemoryUsage() const {
+        memory::Report report;
+        report.push_back(memory::OfVector("router.stop_vertices", stops_));
+        report.push_back(memory::OfHashContainer("router.edge_data", edges_));
+        if (graph_) {
+            // Каждое ребро лежит в массиве рёбер и один раз в списке инцидентности
+            report.push_back({"router.graph",
+                graph_->GetEdgeCount() * (sizeof(Edge<Time>) + sizeof(EdgeId)),
+                graph_->GetVertexCount() * sizeof(std::vector<EdgeId>)});
+        }
+        if (router_) {
+            report.push_back(router_->GetMemoryUsage());
+        }
+        return report;
+    }
+
 }
\ No newline at end of file
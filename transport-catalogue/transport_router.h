@@ -4,6 +4,7 @@
 #include "router.h"
 #include "log_duration.h"
 
+#include <memory>
 #include <numeric>
 
 namespace transport_router {
@@ -11,32 +12,40 @@ namespace transport_router {
     using namespace router_data;
     using namespace graph;
 
+    // Маршрутизатор строится один раз в LoadCatalogue по замороженному каталогу.
+    // После этого объект не изменяется, и GetRoute можно вызывать из нескольких потоков
     class TransportRouter{
 
         public:
 
-            explicit TransportRouter(transport::Catalogue& catalogue) 
+            explicit TransportRouter(const transport::Catalogue& catalogue) 
                 : catalogue_(catalogue) {}
 
             void SetSettings(Settings settings){
                 settings_ = settings;
             }
 
+            const Settings& GetSettings() const {
+                return settings_;
+            }
+
             void LoadCatalogue();
 
             std::optional<Response> GetRoute (Stop* start, Stop* end) const;
 
+            memory::Report GetMemoryUsage() const;
+
         private:
             //Basic setup
-            transport::Catalogue& catalogue_;
+            const transport::Catalogue& catalogue_;
             
             //Contents filled lately
             Settings settings_;
             VertexId last_id_ = 0;
-            std::unordered_map<Stop*,StopVertexPair> stops_;
+            std::vector<StopVertexPair> stops_; // индекс - Stop::id
             std::unordered_map<EdgeId,EdgeData> edges_;
-            DirectedWeightedGraph<Time>* graph_;
-            Router<Time>* router_;
+            std::unique_ptr<DirectedWeightedGraph<Time>> graph_;
+            std::unique_ptr<Router<Time>> router_;
 
             void AddStop (Stop* stop);
             void AddBus (Bus* bus);